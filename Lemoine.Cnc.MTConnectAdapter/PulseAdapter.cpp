@@ -33,6 +33,7 @@
 */
 
 #include "PulseAdapter.h"
+#include "derived_signals.hpp"
 #include "StringConversion.h"
 
 namespace Lemoine
@@ -53,7 +54,9 @@ namespace Lemoine
       , a (NULL)
       , b (NULL)
       , c (NULL)
+      , position (NULL)
       , feedrate (NULL)
+      , derivedFeedrate (NULL)
       , spindleSpeed (NULL)
       , feedrateOverride (NULL)
       , spindleSpeedOverride (NULL)
@@ -67,63 +70,8 @@ namespace Lemoine
 
     PulseAdapter::!PulseAdapter ()
     {
-      if (NULL != availability) {
-        delete availability;
-      }
-      if (NULL != execution) {
-        delete execution;
-      }
-      if (NULL != mode) {
-        delete mode;
-      }
-      if (NULL != programName) {
-        delete programName;
-      }
-      if (NULL != x) {
-        delete x;
-      }
-      if (NULL != y) {
-        delete y;
-      }
-      if (NULL != z) {
-        delete z;
-      }
-      if (NULL != u) {
-        delete u;
-      }
-      if (NULL != v) {
-        delete v;
-      }
-      if (NULL != w) {
-        delete w;
-      }
-      if (NULL != a) {
-        delete a;
-      }
-      if (NULL != b) {
-        delete b;
-      }
-      if (NULL != c) {
-        delete c;
-      }
-      if (NULL != feedrate) {
-        delete feedrate;
-      }
-      if (NULL != spindleSpeed) {
-        delete spindleSpeed;
-      }
-      if (NULL != feedrateOverride) {
-        delete feedrateOverride;
-      }
-      if (NULL != spindleSpeedOverride) {
-        delete spindleSpeedOverride;
-      }
-      if (NULL != cncPartCount) {
-        delete cncPartCount;
-      }
-      if (NULL != toolNumber) {
-        delete toolNumber;
-      }
+      // The data values are owned by the arena of the adapter,
+      // that the finalizer of Adapter releases after this one
     }
 
     String^ PulseAdapter::ToString ()
@@ -137,7 +85,7 @@ namespace Lemoine
     void PulseAdapter::Available::set (bool value)
     {
       if (NULL == availability) {
-        availability = new Availability ("avail");
+        availability = mDatumArena->create<Availability> ("avail");
         addDatum (*availability);
       }
       if (true == value) {
@@ -187,10 +135,24 @@ namespace Lemoine
       C = value.C;
     }
 
+    void PulseAdapter::PositionVector::set (Lemoine::Cnc::Position value)
+    {
+      if (NULL == position) {
+        position = mDatumArena->create<VectorSample> ("p1Position");
+        position->setDimension (9);
+        addDatum (*position);
+      }
+      double values[9] = { value.X, value.Y, value.Z,
+        value.U, value.V, value.W,
+        value.A, value.B, value.C };
+      position->setValue (values);
+      Available = true;
+    }
+
     void PulseAdapter::X::set (double value)
     {
       if (NULL == x) {
-        x = new Sample ("X1actm");
+        x = mDatumArena->create<Sample> ("X1actm");
         addDatum (*x);
       }
       x->setValue (value);
@@ -200,7 +162,7 @@ namespace Lemoine
     void PulseAdapter::Y::set (double value)
     {
       if (NULL == y) {
-        y = new Sample ("Y1actm");
+        y = mDatumArena->create<Sample> ("Y1actm");
         addDatum (*y);
       }
       y->setValue (value);
@@ -210,7 +172,7 @@ namespace Lemoine
     void PulseAdapter::Z::set (double value)
     {
       if (NULL == z) {
-        z = new Sample ("Z1actm");
+        z = mDatumArena->create<Sample> ("Z1actm");
         addDatum (*z);
       }
       z->setValue (value);
@@ -220,7 +182,7 @@ namespace Lemoine
     void PulseAdapter::U::set (double value)
     {
       if (NULL == u) {
-        u = new Sample ("U1actm");
+        u = mDatumArena->create<Sample> ("U1actm");
         addDatum (*u);
       }
       u->setValue (value);
@@ -230,7 +192,7 @@ namespace Lemoine
     void PulseAdapter::V::set (double value)
     {
       if (NULL == v) {
-        v = new Sample ("V1actm");
+        v = mDatumArena->create<Sample> ("V1actm");
         addDatum (*v);
       }
       v->setValue (value);
@@ -240,7 +202,7 @@ namespace Lemoine
     void PulseAdapter::W::set (double value)
     {
       if (NULL == w) {
-        w = new Sample ("W1actm");
+        w = mDatumArena->create<Sample> ("W1actm");
         addDatum (*w);
       }
       w->setValue (value);
@@ -250,7 +212,7 @@ namespace Lemoine
     void PulseAdapter::A::set (double value)
     {
       if (NULL == a) {
-        a = new Sample ("A1actm");
+        a = mDatumArena->create<Sample> ("A1actm");
         addDatum (*a);
       }
       a->setValue (value);
@@ -260,7 +222,7 @@ namespace Lemoine
     void PulseAdapter::B::set (double value)
     {
       if (NULL == b) {
-        b = new Sample ("B1actm");
+        b = mDatumArena->create<Sample> ("B1actm");
         addDatum (*b);
       }
       b->setValue (value);
@@ -270,7 +232,7 @@ namespace Lemoine
     void PulseAdapter::C::set (double value)
     {
       if (NULL == c) {
-        c = new Sample ("C1actm");
+        c = mDatumArena->create<Sample> ("C1actm");
         addDatum (*c);
       }
       c->setValue (value);
@@ -280,17 +242,42 @@ namespace Lemoine
     void PulseAdapter::Feedrate::set (double value)
     {
       if (NULL == feedrate) {
-        feedrate = new Sample ("p1Fact");
+        feedrate = mDatumArena->create<Sample> ("p1Fact");
         addDatum (*feedrate);
       }
       feedrate->setValue (value);
       Available = true;
     }
 
+    void PulseAdapter::FeedrateFromPosition::set (bool value)
+    {
+      if (false == value || NULL != derivedFeedrate) {
+        return;
+      }
+      if (NULL == x) {
+        x = mDatumArena->create<Sample> ("X1actm");
+        addDatum (*x);
+      }
+      if (NULL == y) {
+        y = mDatumArena->create<Sample> ("Y1actm");
+        addDatum (*y);
+      }
+      if (NULL == z) {
+        z = mDatumArena->create<Sample> ("Z1actm");
+        addDatum (*z);
+      }
+      derivedFeedrate = mDatumArena->create<Sample> ("p1Fcalc");
+      addDatum (*derivedFeedrate);
+
+      DerivedSignals *derived = derivedSignals ();
+      int positions[3] = { derived->input (x), derived->input (y), derived->input (z) };
+      derived->rate (positions, 3, 60.0, derivedFeedrate);
+    }
+
     void PulseAdapter::SpindleSpeed::set (double value)
     {
       if (NULL == spindleSpeed) {
-        spindleSpeed = new Sample ("LS1speed");
+        spindleSpeed = mDatumArena->create<Sample> ("LS1speed");
         addDatum (*spindleSpeed);
       }
       spindleSpeed->setValue (value);
@@ -300,7 +287,7 @@ namespace Lemoine
     void PulseAdapter::Auto::set(bool value)
     {
       if (NULL == mode) {
-        mode = new ControllerMode("pmode");
+        mode = mDatumArena->create<ControllerMode>("pmode");
         addDatum(*mode);
       }
       if (true == value) {
@@ -312,7 +299,7 @@ namespace Lemoine
     void PulseAdapter::MDI::set(bool value)
     {
       if (NULL == mode) {
-        mode = new ControllerMode("pmode");
+        mode = mDatumArena->create<ControllerMode>("pmode");
         addDatum(*mode);
       }
       if (true == value) {
@@ -324,7 +311,7 @@ namespace Lemoine
     void PulseAdapter::Jog::set(bool value)
     {
       if (NULL == mode) {
-        mode = new ControllerMode("pmode");
+        mode = mDatumArena->create<ControllerMode>("pmode");
         addDatum(*mode);
       }
       if (true == value) {
@@ -336,7 +323,7 @@ namespace Lemoine
     void PulseAdapter::ManualAny::set(bool value)
     {
       if (NULL == mode) {
-        mode = new ControllerMode("pmode");
+        mode = mDatumArena->create<ControllerMode>("pmode");
         addDatum(*mode);
       }
       if (true == value) {
@@ -348,7 +335,7 @@ namespace Lemoine
     void PulseAdapter::Manual::set (bool value)
     {
       if (NULL == mode) {
-        mode = new ControllerMode ("pmode");
+        mode = mDatumArena->create<ControllerMode> ("pmode");
         addDatum (*mode);
       }
       if (true == value) {
@@ -363,7 +350,7 @@ namespace Lemoine
     void PulseAdapter::FeedrateOverride::set (long value)
     {
       if (NULL == feedrateOverride) {
-        feedrateOverride = new Sample ("pFovr");
+        feedrateOverride = mDatumArena->create<Sample> ("pFovr");
         addDatum (*feedrateOverride);
       }
       feedrateOverride->setValue (value);
@@ -373,7 +360,7 @@ namespace Lemoine
     void PulseAdapter::SpindleSpeedOverride::set (long value)
     {
       if (NULL == spindleSpeedOverride) {
-        spindleSpeedOverride = new Sample ("S1ovr");
+        spindleSpeedOverride = mDatumArena->create<Sample> ("S1ovr");
         addDatum (*spindleSpeedOverride);
       }
       spindleSpeedOverride->setValue (value);
@@ -383,7 +370,7 @@ namespace Lemoine
     void PulseAdapter::Running::set (bool value)
     {
       if (NULL == execution) {
-        execution = new Execution ("pexecution");
+        execution = mDatumArena->create<Execution> ("pexecution");
         addDatum (*execution);
       }
       if (true == value) {
@@ -398,7 +385,7 @@ namespace Lemoine
     void PulseAdapter::ProgramName::set (String^ value)
     {
       if (NULL == programName) {
-        programName = new Event ("pprogram");
+        programName = mDatumArena->create<Event> ("pprogram");
         addDatum (*programName);
       }
 
@@ -409,7 +396,7 @@ namespace Lemoine
     void PulseAdapter::CncPartCount::set(int value)
     {
       if (NULL == cncPartCount) {
-        cncPartCount = new IntEvent("ppartcount");
+        cncPartCount = mDatumArena->create<IntEvent>("ppartcount");
         addDatum(*cncPartCount);
       }
 
@@ -420,7 +407,7 @@ namespace Lemoine
     void PulseAdapter::ToolNumber::set(String^ value)
     {
       if (NULL == toolNumber) {
-        toolNumber = new Event("p1CurrentTool");
+        toolNumber = mDatumArena->create<Event>("p1CurrentTool");
         addDatum(*toolNumber);
       }
 
@@ -37,6 +37,7 @@
 
 #include "adapter.hpp"
 #include "device_datum.hpp"
+#include "datum_arena.hpp"
 
 using namespace System;
 using namespace System::Collections;
@@ -73,7 +74,9 @@ namespace Lemoine
       Sample *a;
       Sample *b;
       Sample *c;
+      VectorSample *position;
       Sample *feedrate;
+      Sample *derivedFeedrate;
       Sample *spindleSpeed;
       Sample *feedrateOverride;
       Sample *spindleSpeedOverride;
@@ -156,6 +159,17 @@ namespace Lemoine
         void set (Lemoine::Cnc::Position value);
       }
 
+      /// <summary>
+      /// Position as a single vector of the 9 axes X, Y, Z, U, V, W, A, B, C,
+      /// sent in one field
+      ///
+      /// Sample name: p1Position
+      /// </summary>
+      property Lemoine::Cnc::Position PositionVector
+      {
+        void set (Lemoine::Cnc::Position value);
+      }
+
       /// <summary>
       /// X position
       ///
@@ -256,6 +270,17 @@ namespace Lemoine
         void set (double value);
       }
 
+      /// <summary>
+      /// Compute natively a feedrate in units/min from the X, Y and Z positions,
+      /// each time they change
+      ///
+      /// Sample name: p1Fcalc
+      /// </summary>
+      property bool FeedrateFromPosition
+      {
+        void set (bool value);
+      }
+
       /// <summary>
       /// Spindle speed
       ///
@@ -35,138 +35,657 @@
 #include "internal.hpp"
 #include "adapter.hpp"
 #include "device_datum.hpp"
+#include "binary_buffer.hpp"
+#include "clock.hpp"
+#include "cycle_scheduler.hpp"
+#include "datum_arena.hpp"
+#include "derived_signals.hpp"
+#include "filter.hpp"
+#include "generations.hpp"
 #include "logger.hpp"
+#include "metrics_server.hpp"
+#include "sample_bank.hpp"
+#include "shm_ring.hpp"
+#include "stats.hpp"
+#include "server_host.hpp"
+#include "unavailable_frame.hpp"
+#include "StringConversion.h"
+
+#include <vcclr.h>
 
 namespace Lemoine
 {
   namespace Cnc
   {
+    /* The tick of the cycle scheduler: sends the values of the adapter */
+    class AdapterTask : public CycleTask
+    {
+      gcroot<Adapter^> mAdapter;
+
+    public:
+      AdapterTask(Adapter^ aAdapter) : mAdapter(aAdapter) { }
+      virtual void tick() { mAdapter->tick(); }
+    };
+
     Adapter::Adapter()
       : mNumDeviceData(0)
       , mBuffer (new StringBuffer ())
+      , mBinaryBuffer (new BinaryBuffer ())
+      , mConflated (new StringBuffer ())
+      , mSampleBank (new SampleBank ())
+      , mDatumArena (new DatumArena ())
+      , mUnavailableFrame (new UnavailableFrame ())
+      , mSocketOptions (new SocketOptions ())
+      , mStats (new Stats ())
     {
       mServer = 0;
+      mSource = -1;
+      mSharedHost = false;
+      mHosted = false;
+      mHadClients = false;
+      mBinary = false;
+      mNumAnnounced = 0;
+      mNumFilters = 0;
+      mCycle = 0;
+      mRing = 0;
+      mSharedMemorySize = 1024 * 1024;
       mPort = 7878;
       mHeartbeatFrequency = 10000;
-      mDeviceData = gcnew array <DeviceDatum*> (128);
+      mReplayFrames = 1000;
+      mGenerations = 0;
+      mDerived = 0;
+      mCyclePeriod = 0;
+      mCycleTask = 0;
+      mScheduler = 0;
+      mSchedulerFailed = false;
+      mMetricsPort = 0;
+      mMetricsLoopback = true;
+      mMetrics = false;
+      mDeviceData = gcnew array <DeviceDatum*> (MAX_DEVICE_DATA);
       log = LogManager::GetLogger (String::Format ("{0}",
         Adapter::typeid->FullName));
     }
 
     Adapter::~Adapter()
     {
+      this->!Adapter();
+    }
+
+    /* Also run if the adapter is not disposed: the data values of the arena
+     * are released with the rest of the native resources */
+    Adapter::!Adapter()
+    {
+      /* The scheduler thread uses the server until it is stopped */
+      if (mScheduler) {
+        mScheduler->stop();
+        delete mScheduler;
+        delete mCycleTask;
+      }
+      if (mMetrics) {
+        MetricsServer::instance()->detach(mServer);
+      }
       if (mServer) {
-        delete mServer;
+        mServer->lock();
+        mServer->removeSource(mSource);
+        mServer->unlock();
+        if (mHosted) {
+          ServerHost::instance()->detach(mServer);
+        }
+        else {
+          delete mServer;
+        }
+      }
+      if (mRing) {
+        delete mRing;
       }
       delete mBuffer;
+      delete mBinaryBuffer;
+      delete mConflated;
+      delete mSampleBank;
+      if (mDerived) {
+        delete mDerived;
+      }
+      if (mGenerations) {
+        delete mGenerations;
+      }
+      delete mSocketOptions;
+      delete mStats;
+      delete mUnavailableFrame;
+      delete mDatumArena;
+    }
+
+    void Adapter::DevicePrefix::set (String^ value)
+    {
+      if (mServer != 0) {
+        log->ErrorFormat ("DevicePrefix.set: the adapter is already started, {0} is ignored",
+          value);
+        return;
+      }
+      mDevicePrefix = value;
+      std::string prefix = String::IsNullOrEmpty (value)
+        ? std::string () : Lemoine::Conversion::ConvertToStdString (value);
+      /* The precomputed UNAVAILABLE frame has the names of the items too */
+      mUnavailableFrame->clear();
+      for (int i = 0; i < mNumDeviceData; i++) {
+        mDeviceData[i]->prefixName(prefix.c_str ());
+        mUnavailableFrame->add(mDeviceData[i]);
+      }
     }
 
     /* Add a data value to the list of data values */
     void Adapter::addDatum(DeviceDatum &aValue)
     {
+      if (!String::IsNullOrEmpty (mDevicePrefix)) {
+        aValue.prefixName(Lemoine::Conversion::ConvertToStdString (mDevicePrefix).c_str ());
+      }
       mDeviceData[mNumDeviceData++] = &aValue;
       mDeviceData[mNumDeviceData] = 0;
+
+      /* The numeric samples are staged in the bank, that detects their
+       * changes all at once */
+      Sample *sample = dynamic_cast<Sample*>(&aValue);
+      if (sample != 0) {
+        sample->bind(mSampleBank);
+      }
+      mUnavailableFrame->add(&aValue);
+    }
+
+    /* The derivation graph of the adapter, created on first use */
+    DerivedSignals *Adapter::derivedSignals()
+    {
+      if (mDerived == NULL) {
+        mDerived = new DerivedSignals();
+      }
+      return mDerived;
+    }
+
+    /* Detect the changes of the samples, then update the values derived
+     * from them. The derived samples that were set are detected in turn. */
+    void Adapter::detectChanges()
+    {
+      mSampleBank->detect();
+      if (mDerived != 0 && mDerived->evaluate(monotonicNow()) > 0)
+        mSampleBank->detect();
     }
 
     void Adapter::Start ()
     {
+      double start = monotonicNow();
       if (gLogger == NULL) {
         gLogger = new Logger();
       }
 
       if (mServer == NULL) {
-        mServer = new Server(mPort, mHeartbeatFrequency);
-      }
+        std::string localPath;
+        if (!String::IsNullOrEmpty (mLocalSocketPath)) {
+          localPath = Lemoine::Conversion::ConvertToStdString (mLocalSocketPath);
+        }
+        if (mSharedHost) {
+          mServer = ServerHost::instance()->attach(mPort, mHeartbeatFrequency,
+            localPath.c_str (), *mSocketOptions);
+          mHosted = (mServer != NULL);
+        }
+        if (mServer == NULL) {
+          mServer = new Server(mPort, mHeartbeatFrequency, localPath.c_str ());
+          mServer->setSocketOptions(*mSocketOptions);
+        }
+        mServer->lock();
+        mSource = mServer->addSource();
+        mServer->setStats(mSource, mStats);
+        mServer->setReplayFrames(mReplayFrames);
+        mServer->unlock();
 
-      /* Check if we have any new clients */
-      Client **clients = mServer->connectToClients();
-      bool hasClients = false;
-      if (clients != 0) {
-        hasClients = true;
-        for (int i = 0; clients[i] != 0; i++) {
-          /* If there are any new clients, send them the initial values for all the 
-          * data values */
-          sendInitialData(clients[i]);
+        if (!String::IsNullOrEmpty (mDevicePrefix)) {
+          mStats->setName(Lemoine::Conversion::ConvertToStdString (mDevicePrefix).c_str ());
         }
+        if (mMetricsPort > 0 &&
+            MetricsServer::instance()->start(mMetricsPort, mMetricsLoopback)) {
+          MetricsServer::instance()->attach(mServer);
+          mMetrics = true;
+        }
+      }
+
+      if (mRing == NULL && !String::IsNullOrEmpty (mSharedMemoryName)) {
+        mRing = new ShmRing(Lemoine::Conversion::ConvertToStdString (mSharedMemoryName).c_str (),
+          (uint32_t) mSharedMemorySize);
       }
 
-      /* Read and all data from the clients */
-      mServer->readFromClients();
+      /* With a scheduler, the values are sent from its thread and the
+       * acquisition only commits them. If its thread could not be started,
+       * the values are sent by Finish, without trying again. */
+      if (mCyclePeriod > 0 && mScheduler == NULL && !mSchedulerFailed) {
+        beginCycle();
+        mCycleTask = new AdapterTask(this);
+        mScheduler = new CycleScheduler(mCycleTask, mCyclePeriod);
+        if (!mScheduler->start()) {
+          delete mScheduler;
+          delete mCycleTask;
+          mScheduler = NULL;
+          mCycleTask = NULL;
+          mSchedulerFailed = true;
+        }
+      }
+      if (mScheduler != NULL) {
+        mStats->record(Stats::eSTART, start);
+        return;
+      }
 
       /* Don't bother getting data if we don't have anyone to read it */
-      if (mServer->numClients() > 0) {
+      if (serviceClients()) {
         mBuffer->timestamp();
       }
-      else if (hasClients) {
-        hasClients = false;
+      mStats->record(Stats::eSTART, start);
+    }
+
+    /* Accept the new clients and read their requests, then send the initial
+     * data to the ones that need them. Returns true if there is any consumer
+     * of the data. */
+    bool Adapter::serviceClients ()
+    {
+      mServer->lock();
+
+      /* Check if we have any new clients and read all data from the clients,
+       * unless the I/O thread of the host does it */
+      if (!mHosted) {
+        mServer->connectToClients();
+        mServer->readFromClients();
+      }
+
+      /* If there are any new clients, send them the initial values for all the 
+       * data values */
+      Client *client;
+      while ((client = mServer->nextPendingClient(mSource)) != 0) {
+        if (client->mBinary)
+          sendBinaryInitialData(client);
+        else
+          sendInitialData(client);
+        client->mSentCycle[mSource] = mCycle;
+        client->mSentTime[mSource] = mServer->getTimestamp();
+      }
+
+      /* A new reader of the shared memory needs the initial values too */
+      if (mRing != NULL && mRing->snapshotRequested()) {
+        sendInitialData(0);
+      }
+
+      bool hasClients = (mServer->numClients() > 0);
+      bool consumers = hasConsumers();
+      mServer->unlock();
+
+      if (mHadClients && !hasClients) {
         clientsDisconnected();
       }
+      mHadClients = hasClients;
+      return consumers;
     }
 
     void Adapter::Finish ()
     {
-      if (mServer->numClients() > 0) {
+      if (mServer == NULL) {
+        return;
+      }
+      /* Without a scheduler, the values are committed and sent at once */
+      if (mCyclePeriod > 0 || mScheduler != NULL) {
+        commitCycle();
+      }
+      if (mScheduler != NULL) {
+        return;
+      }
+      mServer->lock();
+      if (hasConsumers()) {
+        sendChangedData();
+        mBuffer->reset();
+      }
+      mServer->unlock();
+    }
+
+    /* Called by the scheduler at each period, from its own thread. The
+     * values are the ones of the last committed cycle. */
+    void Adapter::tick ()
+    {
+      bool consumers = serviceClients();
+      mServer->lock();
+      if (consumers) {
+        mBuffer->timestamp();
         sendChangedData();
         mBuffer->reset();
       }
+      mServer->unlock();
     }
 
-    /* Send a single value to the buffer. */
-    void Adapter::sendDatum(DeviceDatum *aValue)
+    int Adapter::CycleOverruns::get ()
     {
+      return (mScheduler != NULL) ? (int) mScheduler->mOverruns : 0;
+    }
+
+    String^ Adapter::Statistics::get ()
+    {
+      char text[4096];
+      int length = mStats->format(text, sizeof(text), "adapter");
+      if (mServer != NULL) {
+        mServer->lock();
+        mServer->stats().format(text + length, sizeof(text) - length, "server");
+        mServer->unlock();
+      }
+      return gcnew String (text);
+    }
+
+    void Adapter::beginCycle ()
+    {
+      if (mGenerations == NULL) {
+        mGenerations = new Generations();
+      }
+    }
+
+    void Adapter::commitCycle ()
+    {
+      if (mGenerations == NULL) {
+        return;
+      }
+      detectChanges();
+      mGenerations->beginCommit();
+      for (int i = 0; i < mNumDeviceData; i++) {
+        DeviceDatum *value = mDeviceData[i];
+        if (value->changed())
+          mGenerations->commit(value, i);
+      }
+      mGenerations->endCommit();
+    }
+
+    /* Is there any socket client or shared memory reader to send the data to ? */
+    bool Adapter::hasConsumers()
+    {
+      return (mServer != 0 && mServer->numClients() > 0) ||
+        (mRing != 0 && mRing->hasReaders());
+    }
+
+    /* Send a single value to the buffer. The values that require a flush are
+     * written on their own line, the whole cycle is sent at once by sendBuffer.
+     * The value is also encoded for the binary clients if there are some. */
+    void Adapter::sendDatum(DeviceDatum *aValue, int aIndex)
+    {
+      if (mBinary)
+        aValue->appendBinary(*mBinaryBuffer, binaryId(aIndex));
+      if (mNumFilters > 0)
+        appendFiltered(aValue);
       if (aValue->requiresFlush())
-        sendBuffer();
+        mBuffer->newLine();
       aValue->append(*mBuffer);
       if (aValue->requiresFlush())
-        sendBuffer();
+        mBuffer->newLine();
+    }
+
+    /* Append a value to the frames of the subscriptions it matches. The text
+     * is formatted only once for all of them. */
+    void Adapter::appendFiltered(DeviceDatum *aValue)
+    {
+      const char *text = 0;
+      for (int i = 0; i < mNumFilters; i++) {
+        Filter *filter = mServer->filter(i);
+        if (filter->matches(aValue->getName())) {
+          if (text == 0)
+            text = aValue->fragment();
+          if (aValue->requiresFlush())
+            filter->mBuffer.newLine();
+          filter->mBuffer.append(text);
+          if (aValue->requiresFlush())
+            filter->mBuffer.newLine();
+        }
+      }
+    }
+
+    /* The value the new clients and the clients with an update rate get:
+     * with the cycle commits, the last committed value that was sent, 0 if
+     * there is none yet, never the value being acquired */
+    DeviceDatum *Adapter::sentValue(int aIndex)
+    {
+      if (mGenerations != 0)
+        return mGenerations->latest(aIndex);
+      return mDeviceData[aIndex];
+    }
+
+    /* Send the clients with an update rate that are due, and the clients that
+     * must catch up after their backlog was dropped, the latest value of the
+     * data items that changed since their previous update. Clients that got
+     * the same cycles with the same subscription share the frame. */
+    void Adapter::sendConflated()
+    {
+      unsigned int now = mServer->getTimestamp();
+      bool built = false;
+      unsigned int builtSince = 0;
+      Filter *builtFilter = 0;
+
+      unsigned int bit = 1u << mSource;
+
+      for (int i = mServer->numClients() - 1; i >= 0; i--) {
+        Client *client = mServer->client(i);
+        if (client->mBinary)
+          continue;
+        if (client->mLaggingSources & bit) {
+          /* Wait until the client has received what was already sent */
+          if (client->backlogged())
+            continue;
+        }
+        else if (client->mPeriod == 0 ||
+                 mServer->deltaTimestamp(now, client->mSentTime[mSource]) < client->mPeriod)
+          continue;
+
+        unsigned int since = client->mSentCycle[mSource];
+        Filter *filter = client->mFilter;
+        if (!built || since != builtSince || filter != builtFilter) {
+          mConflated->reset();
+          mConflated->timestamp(*mBuffer);
+          for (int j = 0; j < mNumDeviceData; j++) {
+            DeviceDatum *value = sentValue(j);
+            if (value != 0 && (int) (mDeviceData[j]->cycle() - since) > 0 &&
+                (filter == 0 || filter->matches(value->getName()))) {
+              if (value->requiresFlush())
+                mConflated->newLine();
+              mConflated->append(value->fragment());
+              if (value->requiresFlush())
+                mConflated->newLine();
+            }
+          }
+          mConflated->newLine();
+          built = true;
+          builtSince = since;
+          builtFilter = filter;
+        }
+
+        client->mLaggingSources &= ~bit;
+        if (mConflated->length() > 0) {
+          client->mSentTime[mSource] = now;
+          if (!mServer->sendToClient(client, *mConflated))
+            continue;
+        }
+        if (!client->backlogged())
+          client->mSentCycle[mSource] = mCycle;
+      }
     }
 
-    /* Send the buffer to the clients. Only sends if there is something in the buffer. */
+    /* The clients that got the frame of the cycle without any backlog have
+     * all the changes up to this cycle. For the other ones, the next
+     * conflated frame will start earlier, which is safe. */
+    void Adapter::updateSentCycles()
+    {
+      unsigned int bit = 1u << mSource;
+      for (int i = mServer->numClients() - 1; i >= 0; i--) {
+        Client *client = mServer->client(i);
+        if (client->mPeriod == 0 && (client->mLaggingSources & bit) == 0 &&
+            !client->backlogged())
+          client->mSentCycle[mSource] = mCycle;
+      }
+    }
+
+    /* Announce the data values from aFirst to the binary clients: the id of
+     * a value is the index of the source in the server and its own index */
+    void Adapter::appendDictionary(int aFirst)
+    {
+      mBinaryBuffer->beginFrame(BINARY_DICTIONARY);
+      for (int i = aFirst; i < mNumDeviceData; i++) {
+        DeviceDatum *value = mDeviceData[i];
+        mBinaryBuffer->putVarint(binaryId(i));
+        mBinaryBuffer->putByte(value->binaryType());
+        mBinaryBuffer->putText(value->getName());
+      }
+      mBinaryBuffer->endFrame();
+    }
+
+    /* Send the buffer to the clients and to the shared memory ring. Only sends
+     * if there is something in the buffer. */
     void Adapter::sendBuffer()
     {
-      if (mServer != 0 && mBuffer->length() > 0)
+      if (mBuffer->length() > 0)
       {
-        mBuffer->append("\n");
-        mServer->sendToClients(*mBuffer);
+        mBuffer->newLine();
+        if (mServer != 0)
+          mServer->sendToClients(*mBuffer, mSource);
+        if (mRing != 0)
+          mRing->write(*mBuffer, mBuffer->length());
         mBuffer->reset();  
       }
+
+      /* A filter may be released when its last client is removed on a write
+       * error, so iterate backwards and do not touch it after the send. The
+       * buffers are reset at the beginning of the next cycle. */
+      for (int i = mNumFilters - 1; i >= 0; i--) {
+        Filter *filter = mServer->filter(i);
+        if (filter->mBuffer.length() > 0) {
+          filter->mBuffer.newLine();
+          mServer->sendToClients(filter->mBuffer, mSource, filter);
+        }
+      }
+      mNumFilters = 0;
+
+      if (mServer != 0 && mSource >= 0) {
+        updateSentCycles();
+        sendConflated();
+      }
+
+      if (mBinary)
+      {
+        mBinaryBuffer->endFrame();
+        if (mBinaryBuffer->length() > 0)
+          mServer->sendBinaryToClients(mBinaryBuffer->data(), (int) mBinaryBuffer->length(), mSource);
+        mBinaryBuffer->reset();
+        mBinary = false;
+      }
     }
 
-    /* Send the initial values to a client */
+    /* Send the initial values to a client, or to the shared memory ring if
+     * aClient is 0. The changed flags are left alone: the initial values may
+     * be sent by the scheduler thread while the values are acquired, and
+     * the changes must still be committed and sent to the other clients. */
     void Adapter::sendInitialData(Client *aClient)
     {
       log->Debug ("sendInitialiData /B");
+      double start = monotonicNow();
       mDisableFlush = true;
       mBuffer->timestamp();
 
+      /* A client with a subscription only gets the values it subscribed to */
+      Filter *filter = (aClient != 0) ? aClient->mFilter : 0;
       for (int i = 0; i < mNumDeviceData; i++) {
-        DeviceDatum *value = mDeviceData[i];
-        if (value->hasInitialValue())
-          sendDatum(value);
+        DeviceDatum *value = sentValue(i);
+        if (value != 0 && value->hasInitialValue() &&
+            (filter == 0 || filter->matches(value->getName()))) {
+          if (value->requiresFlush())
+            mBuffer->newLine();
+          mBuffer->append(value->fragment());
+          if (value->requiresFlush())
+            mBuffer->newLine();
+        }
+      }
+      if (mBuffer->length() > 0) {
+        mBuffer->newLine();
+        if (aClient != 0)
+          mServer->sendToClient(aClient, *mBuffer);
+        else if (mRing != 0)
+          mRing->write(*mBuffer, mBuffer->length());
+        mBuffer->reset();
       }
-      sendBuffer();
       mDisableFlush = false;
+      mStats->record(Stats::eINITIAL, start);
+    }
+
+    /* Send the dictionary and the initial values to a client of the binary
+     * protocol */
+    void Adapter::sendBinaryInitialData(Client *aClient)
+    {
+      mBinaryBuffer->reset();
+      appendDictionary(0);
+      mBinaryBuffer->beginValues();
+      for (int i = 0; i < mNumDeviceData; i++) {
+        DeviceDatum *value = sentValue(i);
+        if (value != 0 && value->hasInitialValue())
+          value->appendBinary(*mBinaryBuffer, binaryId(i));
+      }
+      mBinaryBuffer->endFrame();
+      if (mBinaryBuffer->length() > 0)
+        mServer->sendBinaryToClient(aClient, mBinaryBuffer->data(), (int) mBinaryBuffer->length());
+      mBinaryBuffer->reset();
     }
 
     /* Send the values that have changed to the clients */
     void Adapter::sendChangedData()
     {
+      double start = monotonicNow();
+      mCycle++;
+
+      /* The binary clients first learn about the data values added since the
+       * previous cycle */
+      mBinary = (mServer != 0 && mServer->hasBinaryClients());
+      if (mBinary) {
+        if (mNumAnnounced < mNumDeviceData)
+          appendDictionary(mNumAnnounced);
+        mBinaryBuffer->beginValues();
+      }
+      mNumAnnounced = mNumDeviceData;
+
+      /* The frames of the subscriptions are built along with the full one */
+      mNumFilters = (mServer != 0) ? mServer->numFilters() : 0;
+      for (int i = 0; i < mNumFilters; i++) {
+        Filter *filter = mServer->filter(i);
+        filter->mBuffer.reset();
+        filter->mBuffer.timestamp(*mBuffer);
+      }
+
+      /* With the cycle commits, the values are the ones of the last committed
+       * generation */
+      if (mGenerations == 0)
+        detectChanges();
+      bool committed = (mGenerations != 0 && mGenerations->swap());
+      unsigned int items = 0;
       for (int i = 0; i < mNumDeviceData; i++)
       {
         DeviceDatum *value = mDeviceData[i];
-        if (value->changed())
-          sendDatum(value);
+        if (mGenerations != 0)
+          value = committed ? mGenerations->front(i) : 0;
+        if (value != 0 && value->changed()) {
+          mDeviceData[i]->setCycle(mCycle);
+          sendDatum(value, i);
+          if (mGenerations != 0)
+            mGenerations->sent(i);
+          items++;
+        }
       }  
+      unsigned int bytes = (unsigned int) mBuffer->length();
       sendBuffer();
+      mStats->recordCycle(items, bytes);
+      mStats->record(Stats::eCHANGED, start);
     }
 
     void Adapter::flush()
     {
       if (!mDisableFlush)
       {
+        if (mServer != 0)
+          mServer->lock();
         sendChangedData();
         mBuffer->reset();
         mBuffer->timestamp();
+        if (mServer != 0)
+          mServer->unlock();
       }
     }
 
@@ -176,14 +695,69 @@ namespace Lemoine
       printf("All clients have disconnected\n");
     }
 
+    /* Make all the values unavailable. Nothing is sent if they already were,
+     * this may be called at each cycle while the CNC is in error. */
     void Adapter::unavailable()
     {
+      bool changed = false;
       for (int i = 0; i < mNumDeviceData; i++)
       {
         DeviceDatum *value = mDeviceData[i];
-        value->unavailable();
+        if (value->unavailable())
+          changed = true;
+      }
+      if (!changed)
+        return;
+      commitCycle();
+      if (!sendUnavailableFrame())
+        flush();
+    }
+
+    /* Send the precomputed frame where all the values are UNAVAILABLE, once
+     * they were all made unavailable, instead of formatting them again.
+     * Only possible without committed generations, subscriptions or binary
+     * clients, that need the values one by one. Returns false if the frame
+     * could not be used. */
+    bool Adapter::sendUnavailableFrame()
+    {
+      if (mDisableFlush || mGenerations != 0)
+        return false;
+      if (mServer != 0) {
+        mServer->lock();
+        if (mServer->numFilters() > 0 || mServer->hasBinaryClients()) {
+          mServer->unlock();
+          return false;
+        }
+      }
+
+      /* The changes are all in the frame: the flags are cleared in bulk, and
+       * the values belong to this cycle for the clients with an update rate */
+      mCycle++;
+      detectChanges();
+      for (int i = 0; i < mNumDeviceData; i++) {
+        DeviceDatum *value = mDeviceData[i];
+        value->reset();
+        value->setCycle(mCycle);
       }
-      flush();
+
+      int length;
+      mBuffer->timestamp();
+      const char *frame = mUnavailableFrame->frame(mBuffer->getTimestamp(), length);
+      if (length > 0) {
+        if (mServer != 0)
+          mServer->sendToClients(frame, mSource);
+        if (mRing != 0)
+          mRing->write(frame, length);
+      }
+      if (mServer != 0 && mSource >= 0) {
+        updateSentCycles();
+        sendConflated();
+      }
+      mBuffer->reset();
+
+      if (mServer != 0)
+        mServer->unlock();
+      return true;
     }
   }
 }
@@ -42,6 +42,16 @@ using namespace System;
 using namespace Lemoine::Core::Log;
 
 class DeviceDatum;
+class ShmRing;
+class BinaryBuffer;
+class Generations;
+class SampleBank;
+class DatumArena;
+class DerivedSignals;
+class UnavailableFrame;
+class CycleScheduler;
+class CycleTask;
+class Stats;
 
 namespace Lemoine
 {
@@ -66,33 +76,256 @@ namespace Lemoine
         void set (int value) { mPort = value; }
       }
 
+      /// <summary>
+      /// Path of an additional Unix domain socket to listen on, for the agents
+      /// that run on the same host (default: none)
+      ///
+      /// Set Port to 0 to listen only on this local socket
+      /// </summary>
+      property String^ LocalSocketPath
+      {
+        String^ get () { return mLocalSocketPath; }
+        void set (String^ value) { mLocalSocketPath = value; }
+      }
+
+      /// <summary>
+      /// Name of a shared memory ring buffer the frames are also written to,
+      /// for the consumers that run on the same host (default: none)
+      ///
+      /// For example /pomamo-shdr-1 on Linux or Local\pomamo-shdr-1 on Windows
+      /// </summary>
+      property String^ SharedMemoryName
+      {
+        String^ get () { return mSharedMemoryName; }
+        void set (String^ value) { mSharedMemoryName = value; }
+      }
+
+      /// <summary>
+      /// Size in bytes of the shared memory ring buffer (default: 1 MB)
+      /// </summary>
+      property int SharedMemorySize
+      {
+        int get () { return mSharedMemorySize; }
+        void set (int value) { mSharedMemorySize = value; }
+      }
+
+      /// <summary>
+      /// Serve the clients from the I/O thread that is shared by all the
+      /// adapters of the process, instead of polling the sockets in Start
+      /// (default: false)
+      ///
+      /// Adapters that use the same port then share the same server
+      /// </summary>
+      property bool SharedHost
+      {
+        bool get () { return mSharedHost; }
+        void set (bool value) { mSharedHost = value; }
+      }
+
+      /// <summary>
+      /// Device name to prefix the data items with, as device:item, when
+      /// several adapters share the same port (default: none).
+      /// It applies to the data items already added too, but it can't be
+      /// changed once the adapter is started
+      /// </summary>
+      property String^ DevicePrefix
+      {
+        String^ get () { return mDevicePrefix; }
+        void set (String^ value);
+      }
+
+      /// <summary>
+      /// Disable Nagle's algorithm on the client sockets (default: true)
+      /// </summary>
+      property bool NoDelay
+      {
+        bool get () { return mSocketOptions->mNoDelay; }
+        void set (bool value) { mSocketOptions->mNoDelay = value; }
+      }
+
+      /// <summary>
+      /// Send buffer size in bytes of the client sockets (default: 0, system default)
+      /// </summary>
+      property int SendBufferSize
+      {
+        int get () { return mSocketOptions->mSendBufferSize; }
+        void set (int value) { mSocketOptions->mSendBufferSize = value; }
+      }
+
+      /// <summary>
+      /// Enable TCP keepalive on the client sockets (default: true)
+      /// </summary>
+      property bool KeepAlive
+      {
+        bool get () { return mSocketOptions->mKeepAlive; }
+        void set (bool value) { mSocketOptions->mKeepAlive = value; }
+      }
+
+      /// <summary>
+      /// Idle time in seconds before the first keepalive probe (default: 0, system default)
+      /// </summary>
+      property int KeepAliveIdle
+      {
+        int get () { return mSocketOptions->mKeepAliveIdle; }
+        void set (int value) { mSocketOptions->mKeepAliveIdle = value; }
+      }
+
+      /// <summary>
+      /// Interval in seconds between two keepalive probes (default: 0, system default)
+      /// </summary>
+      property int KeepAliveInterval
+      {
+        int get () { return mSocketOptions->mKeepAliveInterval; }
+        void set (int value) { mSocketOptions->mKeepAliveInterval = value; }
+      }
+
+      /// <summary>
+      /// Number of recent frames kept for the clients that resume after a
+      /// reconnection (default: 1000, 0: disabled)
+      /// </summary>
+      property int ReplayFrames
+      {
+        int get () { return mReplayFrames; }
+        void set (int value) { mReplayFrames = value; }
+      }
+
+      /// <summary>
+      /// Output in bytes a client may have pending before its backlog is dropped
+      /// and replaced by the latest values (default: 1 MB, 0: no limit)
+      /// </summary>
+      property int MaxBacklog
+      {
+        int get () { return mSocketOptions->mMaxBacklog; }
+        void set (int value) { mSocketOptions->mMaxBacklog = value; }
+      }
+
+      /// <summary>
+      /// Period in ms at which the changed values are sent, from a thread of
+      /// the adapter, whatever the time the acquisition takes (default: 0,
+      /// the values are sent by Finish)
+      ///
+      /// Finish then only commits the values of the cycle, see commitCycle
+      /// </summary>
+      property int CyclePeriod
+      {
+        int get () { return mCyclePeriod; }
+        void set (int value) { mCyclePeriod = value; }
+      }
+
+      /// <summary>
+      /// Number of periods that were skipped because the sending of the
+      /// values took longer than CyclePeriod
+      /// </summary>
+      property int CycleOverruns
+      {
+        int get ();
+      }
+
+      /// <summary>
+      /// Port of the listener that exposes the metrics of the adapters in the
+      /// text format of Prometheus (default: 0, disabled)
+      ///
+      /// The listener is shared by all the adapters of the process: the
+      /// first port that is set is used
+      /// </summary>
+      property int MetricsPort
+      {
+        int get () { return mMetricsPort; }
+        void set (int value) { mMetricsPort = value; }
+      }
+
+      /// <summary>
+      /// Only accept the metrics requests from the local host (default: true)
+      /// </summary>
+      property bool MetricsLoopbackOnly
+      {
+        bool get () { return mMetricsLoopback; }
+        void set (bool value) { mMetricsLoopback = value; }
+      }
+
+      /// <summary>
+      /// Latency histograms (in microseconds) and counters of the adapter
+      /// and of its server, as the "* stats ..." lines a client gets with
+      /// the "* stats" command
+      /// </summary>
+      property String^ Statistics
+      {
+        String^ get ();
+      }
+
     private: // Members
       ILog^ log;
 
     protected:
       Server *mServer;         /* The socket server */
+      int mSource;             /* Index of this adapter in the server sources */
+      bool mSharedHost;        /* Is the server hosted by the ServerHost ? */
+      bool mHosted;            /* Was the server actually attached to the ServerHost ? */
+      bool mHadClients;        /* Were there clients at the previous cycle ? */
+      String^ mDevicePrefix;   /* Prefix of the data item names, if any */
+      ShmRing *mRing;          /* The shared memory ring buffer, if any */
+      String^ mSharedMemoryName; /* The name of the shared memory ring buffer */
+      int mSharedMemorySize;   /* The size of the shared memory ring buffer */
       StringBuffer *mBuffer;    /* A string buffer to hold the string we write to the streams */
+      BinaryBuffer *mBinaryBuffer; /* The frames for the clients of the binary protocol */
+      bool mBinary;            /* Are the values of the cycle encoded for binary clients too ? */
+      int mNumAnnounced;       /* The data values the binary clients know about */
+      int mNumFilters;         /* The subscriptions the values of the cycle are filtered for */
+      unsigned int mCycle;     /* Number of the current cycle, for the clients with an update rate */
+      StringBuffer *mConflated; /* The latest values for the clients with an update rate */
       array <DeviceDatum*>^ mDeviceData;/* A 0 terminated array of data value objects */
       int mNumDeviceData;     /* The number of data values */
       int mPort;              /* The server port we bind to */
+      String^ mLocalSocketPath; /* The Unix domain socket we bind to, if any */
       bool mDisableFlush;     /* Used for initial data collection */
       int mHeartbeatFrequency; /* The frequency (ms) to heartbeat
                                * server. Responds to Ping. Default 10 sec */
+      SocketOptions *mSocketOptions; /* Options of the client sockets */
+      int mReplayFrames;       /* Recent frames kept for the clients that resume */
+      Generations *mGenerations; /* The committed values, once beginCycle was called */
+      SampleBank *mSampleBank; /* The staged values of the numeric samples */
+      DatumArena *mDatumArena; /* Owns the data values created by the adapter */
+      DerivedSignals *mDerived; /* The values derived from the samples, if any */
+      UnavailableFrame *mUnavailableFrame; /* All the values UNAVAILABLE, ready to send */
+      int mCyclePeriod;        /* The period of the scheduler in ms, 0 if none */
+      CycleTask *mCycleTask;   /* The tick of the scheduler, that calls tick */
+      CycleScheduler *mScheduler; /* Sends the values at a fixed rate, if any */
+      bool mSchedulerFailed;   /* Could the scheduler thread not be started ? */
+      Stats *mStats;           /* The latencies and the counters of the adapter */
+      int mMetricsPort;        /* The port of the metrics listener, 0 if none */
+      bool mMetricsLoopback;   /* Is the metrics listener on the loopback interface only ? */
+      bool mMetrics;           /* Is the server attached to the metrics listener ? */
 
     protected:
       void addDatum(DeviceDatum &aValue);
+      DerivedSignals *derivedSignals();
+      void detectChanges();
 
       /* Internal buffer sending methods */
+      bool hasConsumers();
       void sendBuffer();
-      void sendDatum(DeviceDatum *aValue);
+      void sendDatum(DeviceDatum *aValue, int aIndex);
+      unsigned int binaryId(int aIndex) { return ((unsigned int) mSource << 8) | aIndex; }
+      void appendDictionary(int aFirst);
+      void appendFiltered(DeviceDatum *aValue);
+      void sendConflated();
+      DeviceDatum *sentValue(int aIndex);
+      void updateSentCycles();
       virtual void sendInitialData(Client *aClient);
+      void sendBinaryInitialData(Client *aClient);
       virtual void sendChangedData();
       virtual void flush();
       virtual void unavailable();
+      bool sendUnavailableFrame();
+      bool serviceClients();
+
+    internal:
+      void tick();
 
     public:
       Adapter();
       ~Adapter();
+      !Adapter();
 
       /// <summary>
       /// Start method: making everything ready to get some data
@@ -104,6 +337,19 @@ namespace Lemoine
       /// </summary>
       void Finish ();
 
+      /// <summary>
+      /// Begin a cycle of acquisition. From the first call, the values are
+      /// only sent once committed by commitCycle, so that each frame reflects
+      /// one coherent state of the machine. The acquisition may go on while
+      /// the previous commit is sent.
+      /// </summary>
+      void beginCycle ();
+
+      /// <summary>
+      /// Commit the values set since beginCycle: they are sent together
+      /// </summary>
+      void commitCycle ();
+
       /* Overload this method to handle situation when all clients disconnect */
       virtual void clientsDisconnected();
     };
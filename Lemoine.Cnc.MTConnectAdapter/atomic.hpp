@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef ATOMIC_HPP
+#define ATOMIC_HPP
+
+/*
+ * Minimal atomic operations on plain integers, for the data that is shared
+ * between threads or processes without a lock. <atomic> is not available
+ * when compiling with /clr, hence the Interlocked functions on Windows.
+ *
+ * Loads have an acquire semantic, stores a release semantic.
+ */
+
+#ifdef WIN32
+
+inline uint32_t atomicLoad32(volatile uint32_t *aValue)
+{
+  return (uint32_t) InterlockedCompareExchange((volatile LONG *) aValue, 0, 0);
+}
+
+inline void atomicStore32(volatile uint32_t *aValue, uint32_t aNew)
+{
+  InterlockedExchange((volatile LONG *) aValue, (LONG) aNew);
+}
+
+inline uint32_t atomicIncrement32(volatile uint32_t *aValue)
+{
+  return (uint32_t) InterlockedIncrement((volatile LONG *) aValue);
+}
+
+inline uint32_t atomicDecrement32(volatile uint32_t *aValue)
+{
+  return (uint32_t) InterlockedDecrement((volatile LONG *) aValue);
+}
+
+inline uint32_t atomicExchange32(volatile uint32_t *aValue, uint32_t aNew)
+{
+  return (uint32_t) InterlockedExchange((volatile LONG *) aValue, (LONG) aNew);
+}
+
+inline bool atomicCompareExchange32(volatile uint32_t *aValue, uint32_t aExpected, uint32_t aNew)
+{
+  return (uint32_t) InterlockedCompareExchange((volatile LONG *) aValue, (LONG) aNew, (LONG) aExpected) == aExpected;
+}
+
+inline uint64_t atomicLoad64(volatile uint64_t *aValue)
+{
+  return (uint64_t) InterlockedCompareExchange64((volatile LONGLONG *) aValue, 0, 0);
+}
+
+inline void atomicStore64(volatile uint64_t *aValue, uint64_t aNew)
+{
+  InterlockedExchange64((volatile LONGLONG *) aValue, (LONGLONG) aNew);
+}
+
+inline void atomicFence()
+{
+  MemoryBarrier();
+}
+
+#else /* WIN32 */
+
+inline uint32_t atomicLoad32(volatile uint32_t *aValue)
+{
+  return __atomic_load_n(aValue, __ATOMIC_ACQUIRE);
+}
+
+inline void atomicStore32(volatile uint32_t *aValue, uint32_t aNew)
+{
+  __atomic_store_n(aValue, aNew, __ATOMIC_RELEASE);
+}
+
+inline uint32_t atomicIncrement32(volatile uint32_t *aValue)
+{
+  return __atomic_add_fetch(aValue, 1, __ATOMIC_ACQ_REL);
+}
+
+inline uint32_t atomicDecrement32(volatile uint32_t *aValue)
+{
+  return __atomic_sub_fetch(aValue, 1, __ATOMIC_ACQ_REL);
+}
+
+inline uint32_t atomicExchange32(volatile uint32_t *aValue, uint32_t aNew)
+{
+  return __atomic_exchange_n(aValue, aNew, __ATOMIC_ACQ_REL);
+}
+
+inline bool atomicCompareExchange32(volatile uint32_t *aValue, uint32_t aExpected, uint32_t aNew)
+{
+  return __atomic_compare_exchange_n(aValue, &aExpected, aNew, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+inline uint64_t atomicLoad64(volatile uint64_t *aValue)
+{
+  return __atomic_load_n(aValue, __ATOMIC_ACQUIRE);
+}
+
+inline void atomicStore64(volatile uint64_t *aValue, uint64_t aNew)
+{
+  __atomic_store_n(aValue, aNew, __ATOMIC_RELEASE);
+}
+
+inline void atomicFence()
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif /* WIN32 */
+
+#endif
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "binary_buffer.hpp"
+
+BinaryBuffer::BinaryBuffer()
+{
+  mBuffer = 0;
+  mSize = mLength = 0;
+  mFrameStart = mFrameEntries = 0;
+}
+
+BinaryBuffer::~BinaryBuffer()
+{
+  if (mBuffer != 0)
+    free(mBuffer);
+}
+
+/* Make room for aLength more bytes and return where to write them */
+unsigned char *BinaryBuffer::reserve(size_t aLength)
+{
+  if (mLength + aLength > mSize)
+  {
+    size_t newSize = ((mLength + aLength) / 1024 + 1) * 1024;
+    mBuffer = (unsigned char *) realloc(mBuffer, newSize);
+    mSize = newSize;
+  }
+
+  unsigned char *position = mBuffer + mLength;
+  mLength += aLength;
+  return position;
+}
+
+void BinaryBuffer::beginFrame(unsigned char aType)
+{
+  mFrameStart = mLength;
+  unsigned char *header = reserve(BINARY_FRAME_HEADER_LEN);
+  header[0] = aType;
+  mFrameEntries = mLength;
+}
+
+/* Begin a frame of values, with the current time */
+void BinaryBuffer::beginValues()
+{
+  beginFrame(BINARY_VALUES);
+
+  uint64_t now;
+#ifdef WIN32
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  now = (((uint64_t) ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10;
+  now -= 11644473600000000ULL; /* From 1601 to 1970 */
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  now = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+  putVarint(now);
+  mFrameEntries = mLength;
+}
+
+/* Complete the header of the frame. A frame without any entry is removed.
+ * Returns true if the frame was kept. */
+bool BinaryBuffer::endFrame()
+{
+  if (mLength == mFrameEntries)
+  {
+    mLength = mFrameStart;
+    return false;
+  }
+
+  uint32_t length = (uint32_t) (mLength - mFrameStart - BINARY_FRAME_HEADER_LEN);
+  unsigned char *header = mBuffer + mFrameStart;
+  header[1] = (unsigned char) length;
+  header[2] = (unsigned char) (length >> 8);
+  header[3] = (unsigned char) (length >> 16);
+  header[4] = (unsigned char) (length >> 24);
+  return true;
+}
+
+void BinaryBuffer::putVarint(uint64_t aValue)
+{
+  unsigned char *position = reserve(10);
+  int n = 0;
+  while (aValue >= 0x80)
+  {
+    position[n++] = (unsigned char) (aValue | 0x80);
+    aValue >>= 7;
+  }
+  position[n++] = (unsigned char) aValue;
+  mLength -= 10 - n;
+}
+
+void BinaryBuffer::putDouble(double aValue)
+{
+  uint64_t bits;
+  memcpy(&bits, &aValue, sizeof(bits));
+  unsigned char *position = reserve(8);
+  for (int i = 0; i < 8; i++)
+    position[i] = (unsigned char) (bits >> (8 * i));
+}
+
+void BinaryBuffer::putText(const char *aText, size_t aLength)
+{
+  putVarint(aLength);
+  putBytes(aText, aLength);
+}
@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef BINARY_BUFFER_HPP
+#define BINARY_BUFFER_HPP
+
+/*
+ * A growable byte buffer to build the frames of the binary protocol, the
+ * compact alternative to the SHDR text a client can request with "* binary".
+ *
+ * Frame: type (1 byte), payload length (4 bytes, little endian), payload.
+ *
+ * - BINARY_DICTIONARY: for each data item, id (varint), type (1 byte),
+ *   name length (varint) and name. Sent before the first values of an item,
+ *   an item may be announced again with the same id.
+ * - BINARY_VALUES: timestamp in microseconds since 1970 (varint), then for
+ *   each value, (id << 1 | unavailable) as a varint, followed, if available,
+ *   by the value according to the type of the item:
+ *   - BINARY_DOUBLE: IEEE 754 double, 8 bytes, little endian
+ *   - BINARY_INTEGER: zigzag varint
+ *   - BINARY_TEXT: length (varint) and bytes, for the multi-field items the
+ *     fields are separated by '|' as in SHDR
+ *   - BINARY_VECTOR: number of components (varint) then the doubles
+ * - BINARY_COMMAND: the text of an answer to a client command, as "* PONG 10000\n"
+ */
+
+const unsigned char BINARY_DICTIONARY = 'D';
+const unsigned char BINARY_VALUES = 'V';
+const unsigned char BINARY_COMMAND = 'C';
+
+const unsigned char BINARY_DOUBLE = 1;
+const unsigned char BINARY_INTEGER = 2;
+const unsigned char BINARY_TEXT = 3;
+const unsigned char BINARY_VECTOR = 4;
+
+const int BINARY_FRAME_HEADER_LEN = 5;
+
+class BinaryBuffer
+{
+protected:
+  unsigned char *mBuffer;
+  size_t mSize;
+  size_t mLength;
+  size_t mFrameStart;    /* Start of the frame being built */
+  size_t mFrameEntries;  /* Length of the frame once its header (and timestamp) was written */
+
+  unsigned char *reserve(size_t aLength);
+
+public:
+  BinaryBuffer();
+  ~BinaryBuffer();
+
+  const char *data() { return (const char *) mBuffer; }
+  size_t length() { return mLength; }
+  void reset() { mLength = 0; }
+  void truncate(size_t aLength) { mLength = aLength; }
+
+  void beginFrame(unsigned char aType);
+  void beginValues();
+  bool endFrame();
+
+  void putByte(unsigned char aByte) { *reserve(1) = aByte; }
+  void putBytes(const void *aData, size_t aLength) { memcpy(reserve(aLength), aData, aLength); }
+  void putId(unsigned int aId, bool aUnavailable) { putVarint(((uint64_t) aId << 1) | (aUnavailable ? 1 : 0)); }
+  void putVarint(uint64_t aValue);
+  void putInteger(int64_t aValue) { putVarint(((uint64_t) aValue << 1) ^ (uint64_t) (aValue >> 63)); }
+  void putDouble(double aValue);
+  void putText(const char *aText, size_t aLength);
+  void putText(const char *aText) { putText(aText, strlen(aText)); }
+};
+
+#endif
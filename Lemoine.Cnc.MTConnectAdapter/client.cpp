@@ -35,30 +35,307 @@
 #include "internal.hpp"
 #include "client.hpp"
 #include "server.hpp"
+#include "logger.hpp"
+#include "compressor.hpp"
+
+/* Did the last socket operation fail only because it would block ? */
+static bool wouldBlock()
+{
+#ifdef WIN32
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/* Append data to a growable buffer */
+static void store(char *&aBuffer, int &aLength, int &aSize, const char *aData, int aDataLength)
+{
+  if (aLength + aDataLength > aSize)
+  {
+    aSize = ((aLength + aDataLength) / 1024 + 1) * 1024;
+    aBuffer = (char *) realloc(aBuffer, aSize);
+  }
+  memcpy(aBuffer + aLength, aData, aDataLength);
+  aLength += aDataLength;
+}
 
 /* Instance methods */
 Client::Client(SOCKET aSocket)
 {
   mSocket = aSocket;
+#ifdef WIN32
+  u_long nonBlocking = 1;
+  ::ioctlsocket(mSocket, FIONBIO, &nonBlocking);
+#else
+  ::fcntl(mSocket, F_SETFL, ::fcntl(mSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
   mHeartbeats = false;
+  mPendingSources = 0;
+  mBinary = false;
+  mFilter = 0;
+  mPeriod = 0;
+  memset(mSentTime, 0, sizeof(mSentTime));
+  memset(mSentCycle, 0, sizeof(mSentCycle));
+  mDropped = false;
+  mLaggingSources = 0;
+  mConnectTime = 0;
+  mSettled = false;
+  mSequenced = false;
+  strcpy(mPeer, "local");
+  mBytesSent = 0;
+  mPendingHighWater = 0;
+  mHeartbeatInterval = 0;
+  mCompressor = 0;
+  mOutput = mQueue = 0;
+  mOutputStart = mOutputLength = mOutputSize = 0;
+  mQueueLength = mQueueSize = 0;
+  mReplies = 0;
+  mRepliesLength = mRepliesSize = 0;
+  mMaxBacklog = CLIENT_MAX_BACKLOG;
+  mInputStart = mInputLength = 0;
+  mDiscarding = false;
 }
 
 Client::~Client()
 {
   ::shutdown(mSocket, SHUT_RDWR);
   ::closesocket(mSocket);
+  if (mCompressor != 0)
+    delete mCompressor;
+  if (mOutput != 0)
+    free(mOutput);
+  if (mQueue != 0)
+    free(mQueue);
+  if (mReplies != 0)
+    free(mReplies);
+}
+
+/* Apply the socket options. A failure is not fatal, the system defaults are
+ * kept for the corresponding option.
+ */
+void Client::configure(const SocketOptions &aOptions)
+{
+  mMaxBacklog = aOptions.mMaxBacklog;
+
+  int flag = aOptions.mNoDelay ? 1 : 0;
+  if (::setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, (const char *) &flag, sizeof(flag)) == SOCKET_ERROR)
+    gLogger->warning("Could not set TCP_NODELAY on the client socket");
+
+  if (aOptions.mSendBufferSize > 0)
+  {
+    int size = aOptions.mSendBufferSize;
+    if (::setsockopt(mSocket, SOL_SOCKET, SO_SNDBUF, (const char *) &size, sizeof(size)) == SOCKET_ERROR)
+      gLogger->warning("Could not set the send buffer size to %d", size);
+  }
+
+  flag = aOptions.mKeepAlive ? 1 : 0;
+  if (::setsockopt(mSocket, SOL_SOCKET, SO_KEEPALIVE, (const char *) &flag, sizeof(flag)) == SOCKET_ERROR)
+    gLogger->warning("Could not set SO_KEEPALIVE on the client socket");
+
+  if (aOptions.mKeepAlive)
+  {
+#ifdef TCP_KEEPIDLE
+    int idle = aOptions.mKeepAliveIdle;
+    if (idle > 0 &&
+        ::setsockopt(mSocket, IPPROTO_TCP, TCP_KEEPIDLE, (const char *) &idle, sizeof(idle)) == SOCKET_ERROR)
+      gLogger->warning("Could not set the keepalive idle time to %d s", idle);
+#endif
+#ifdef TCP_KEEPINTVL
+    int interval = aOptions.mKeepAliveInterval;
+    if (interval > 0 &&
+        ::setsockopt(mSocket, IPPROTO_TCP, TCP_KEEPINTVL, (const char *) &interval, sizeof(interval)) == SOCKET_ERROR)
+      gLogger->warning("Could not set the keepalive interval to %d s", interval);
+#endif
+  }
+}
+
+/* From now on, every write is sent as a compressed frame. The frames that
+ * are still queued were written before the switch, the answer to the
+ * command included: they are moved to the output buffer to be sent as is. */
+void Client::enableCompression()
+{
+  if (mCompressor != 0)
+    return;
+
+  if (mQueueLength > 0)
+  {
+    if (mOutputStart > 0)
+    {
+      memmove(mOutput, mOutput + mOutputStart, mOutputLength);
+      mOutputStart = 0;
+    }
+    store(mOutput, mOutputLength, mOutputSize, mQueue, mQueueLength);
+    mQueueLength = 0;
+    mRepliesLength = 0;
+  }
+  mCompressor = new Compressor();
 }
 
 int Client::write(const char *aString)
 {
-  return ::send(mSocket, aString, (int) strlen(aString), 0);
+  return write(aString, (int) strlen(aString));
+}
+
+/* Write a frame, or queue it if the socket has not accepted the previous
+ * ones yet. Returns the length of the frame, even if it was dropped, or a
+ * negative value in case of error.
+ */
+int Client::write(const char *aData, int aLength)
+{
+  return queueFrame(aData, aLength, false);
+}
+
+/* Write the reply to a command, like write, but it is never dropped */
+int Client::reply(const char *aData, int aLength)
+{
+  return queueFrame(aData, aLength, true);
 }
 
-int Client::read(char *aBuffer, int aMaxLen)
+int Client::queueFrame(const char *aData, int aLength, bool aReply)
 {
-  int len = recv(mSocket, aBuffer, aMaxLen, 0);
-  if (len >= 0)
-    aBuffer[len] = 0;
-  
+  if (!backlogged())
+    return sendFrame(aData, aLength);
+
+  bool drop = mMaxBacklog > 0 && mQueueLength + aLength > mMaxBacklog;
+  if (drop)
+  {
+    /* The client does not keep up: drop the stale values, and this frame
+     * unless it is a reply. The queued replies are kept, in order. */
+    mQueueLength = 0;
+    if (mRepliesLength > 0)
+      store(mQueue, mQueueLength, mQueueSize, mReplies, mRepliesLength);
+    mDropped = true;
+  }
+  if (!drop || aReply)
+  {
+    store(mQueue, mQueueLength, mQueueSize, aData, aLength);
+    if (aReply)
+      store(mReplies, mRepliesLength, mRepliesSize, aData, aLength);
+    updateHighWater();
+  }
+
+  return (flush() < 0) ? -1 : aLength;
+}
+
+/* Send a frame, compressed if necessary, and keep what the socket does not
+ * accept in the output buffer, which must be empty */
+int Client::sendFrame(const char *aData, int aLength)
+{
+  const char *frame = aData;
+  int frameLength = aLength;
+  if (mCompressor != 0)
+    frame = mCompressor->compress(aData, aLength, frameLength);
+
+  int sent = ::send(mSocket, frame, frameLength, 0);
+  if (sent < 0)
+  {
+    if (!wouldBlock())
+      return -1;
+    sent = 0;
+  }
+  mBytesSent += sent;
+
+  if (sent < frameLength)
+  {
+    mOutputStart = 0;
+    mOutputLength = 0;
+    store(mOutput, mOutputLength, mOutputSize, frame + sent, frameLength - sent);
+    updateHighWater();
+  }
+  return aLength;
+}
+
+/* Send the pending output, as far as the socket accepts it. The queued frames
+ * are sent as a single frame.
+ * Returns a negative value in case of error.
+ */
+int Client::flush()
+{
+  while (backlogged())
+  {
+    if (mOutputLength == 0)
+    {
+      int length = mQueueLength;
+      mQueueLength = 0;
+      mRepliesLength = 0;
+      if (sendFrame(mQueue, length) < 0)
+        return -1;
+      continue;
+    }
+
+    int sent = ::send(mSocket, mOutput + mOutputStart, mOutputLength, 0);
+    if (sent < 0)
+      return wouldBlock() ? 0 : -1;
+
+    mBytesSent += sent;
+    mOutputStart += sent;
+    mOutputLength -= sent;
+    if (mOutputLength > 0)
+      return 0;
+  }
+
+  return 0;
+}
+
+/* Receive what is available on the socket after the lines that are still
+ * pending in the input buffer.
+ * Returns the number of received bytes, 0 if the peer closed the connection,
+ * CLIENT_NO_INPUT if the socket would block, after a spurious readiness for
+ * example, or -1 in case of error.
+ */
+int Client::fill()
+{
+  if (mInputStart > 0)
+  {
+    /* Move the incomplete line to the start of the buffer */
+    mInputLength -= mInputStart;
+    memmove(mInput, mInput + mInputStart, mInputLength);
+    mInputStart = 0;
+  }
+  else if (mInputLength == CLIENT_INPUT_LEN)
+  {
+    /* No end of line in a full buffer: drop the line until its end */
+    mInputLength = 0;
+    mDiscarding = true;
+  }
+
+  int len = recv(mSocket, mInput + mInputLength, CLIENT_INPUT_LEN - mInputLength, 0);
+  if (len > 0)
+    mInputLength += len;
+  else if (len < 0)
+    return wouldBlock() ? CLIENT_NO_INPUT : -1;
+
   return len;
 }
+
+/* Return the next complete line of the input buffer or 0 if there is none.
+ * The line is terminated in place: the end of line, and a possible carriage
+ * return before it, are replaced by '\0'. The line remains valid until the
+ * next call to fill().
+ */
+char *Client::nextLine(int &aLength)
+{
+  while (mInputStart < mInputLength)
+  {
+    char *line = mInput + mInputStart;
+    char *eol = (char *) memchr(line, '\n', mInputLength - mInputStart);
+    if (eol == 0)
+      return 0;
+
+    mInputStart = (int) (eol - mInput) + 1;
+    if (mDiscarding)
+    {
+      mDiscarding = false;
+      continue;
+    }
+
+    if (eol > line && *(eol - 1) == '\r')
+      eol--;
+    *eol = '\0';
+    aLength = (int) (eol - line);
+    return line;
+  }
+
+  return 0;
+}
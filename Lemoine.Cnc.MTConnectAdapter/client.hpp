@@ -35,27 +35,115 @@
 #ifndef CLIENT_HPP
 #define CLIENT_HPP
 
+class Compressor;
+class Filter;
+
+const int MAX_SOURCES = 32;     /* Adapters that can share a server, one bit each */
+
+/* Size of the per-client input buffer. A command line longer than that is discarded. */
+const int CLIENT_INPUT_LEN = 1024;
+
+/* Returned by Client::fill when the socket had nothing to read after all */
+const int CLIENT_NO_INPUT = -2;
+
+/* Time in ms a new client has to send its first command, a "* resume"
+ * for example, before it gets the initial data */
+const int CLIENT_SETTLE_TIME = 100;
+
+/* Default limit of the output a client may have pending */
+const int CLIENT_MAX_BACKLOG = 1024 * 1024;
+
+/*
+ * The options applied to the client sockets once they are accepted.
+ * Since a cycle is sent at once, Nagle's algorithm is disabled by default:
+ * it would only delay the last segment of each cycle.
+ */
+struct SocketOptions
+{
+  bool mNoDelay;          /* TCP_NODELAY */
+  int mSendBufferSize;    /* SO_SNDBUF in bytes, 0 for the system default */
+  bool mKeepAlive;        /* SO_KEEPALIVE */
+  int mKeepAliveIdle;     /* Idle time in s before the first probe, 0 for the system default */
+  int mKeepAliveInterval; /* Interval in s between probes, 0 for the system default */
+  int mMaxBacklog;        /* Queued output in bytes before a client is considered lagging, 0 for no limit */
+
+  SocketOptions()
+    : mNoDelay(true), mSendBufferSize(0), mKeepAlive(true),
+      mKeepAliveIdle(0), mKeepAliveInterval(0), mMaxBacklog(CLIENT_MAX_BACKLOG) { }
+};
+
 /*
  * A wrapper around a client socket. An adapter is capable of managing
  * multiple sockets. 
+ *
+ * The socket is non-blocking. What the socket does not accept is kept in
+ * the output buffer, and the frames written meanwhile are queued. When the
+ * queue exceeds the maximum backlog, the values are dropped and mDropped is
+ * set: the server then sends the client the latest values instead. The
+ * replies to the commands are never dropped.
  */
 class Client
 {
   /* Instance Variables */
 protected:
   SOCKET mSocket;
+  char mInput[CLIENT_INPUT_LEN]; /* Received bytes not processed yet */
+  int mInputStart;               /* Start of the first unprocessed line in mInput */
+  int mInputLength;              /* Number of bytes in mInput */
+  bool mDiscarding;              /* Skipping the end of a too long line */
+  Compressor *mCompressor;       /* Compression state of the stream, 0 if not compressed */
+  char *mOutput;                 /* Part of a frame the socket did not accept yet */
+  int mOutputStart;
+  int mOutputLength;
+  int mOutputSize;
+  char *mQueue;                  /* Frames written since, not compressed yet */
+  int mQueueLength;
+  int mQueueSize;
+  char *mReplies;                /* Copy of the replies in mQueue, kept when it is dropped */
+  int mRepliesLength;
+  int mRepliesSize;
+  int mMaxBacklog;
+
+  int queueFrame(const char *aData, int aLength, bool aReply);
+  int sendFrame(const char *aData, int aLength);
+  void updateHighWater() { if (pending() > mPendingHighWater) mPendingHighWater = pending(); }
 
   /* class methods */
 public:
   bool mHeartbeats;
   unsigned int mLastHeartbeat;
+  unsigned int mPendingSources; /* Sources that must still send their initial data */
+  bool mBinary;                 /* Does the client get the binary frames instead of SHDR ? */
+  Filter *mFilter;              /* The subscription of the client, 0 for all the data items */
+  unsigned int mPeriod;         /* Minimum time in ms between two updates, 0 for every cycle */
+  unsigned int mSentTime[MAX_SOURCES];  /* When each source last sent an update, with a period */
+  unsigned int mSentCycle[MAX_SOURCES]; /* The last cycle of each source the client got */
+  bool mDropped;                /* Was the queue dropped since the server checked ? */
+  unsigned int mLaggingSources; /* Sources that must send the latest values after a drop */
+  unsigned int mConnectTime;    /* When the client was accepted */
+  bool mSettled;                /* Has the client sent a command line ? */
+  bool mSequenced;              /* Does the client get the sequence numbers of the frames ? */
+  char mPeer[32];               /* Address and port of the client, or "local" */
+  unsigned long long mBytesSent; /* Bytes the socket accepted, compressed if so */
+  int mPendingHighWater;        /* Most output that was pending at once */
+  unsigned int mHeartbeatInterval; /* Time in ms between the last two heartbeats */
 
   /* Instance methods */
 public:
   Client(SOCKET aSocket);
   ~Client();
+  void configure(const SocketOptions &aOptions);
+  void enableCompression();
+  bool compressed() { return mCompressor != 0; }
   int write(const char *aString);
-  int read(char *aBuffer, int aLen);
+  int write(const char *aData, int aLength);
+  int reply(const char *aData, int aLength);
+  int flush();
+  bool backlogged() { return mOutputLength > 0 || mQueueLength > 0; }
+  int pending() { return mOutputLength + mQueueLength; }
+  void setMaxBacklog(int aMaxBacklog) { mMaxBacklog = aMaxBacklog; }
+  int fill();
+  char *nextLine(int &aLength);
   SOCKET socket() { return mSocket; }
 };
 
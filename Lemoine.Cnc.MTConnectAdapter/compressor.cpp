@@ -0,0 +1,261 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "compressor.hpp"
+
+static inline uint32_t read32(const unsigned char *aData)
+{
+  uint32_t value;
+  memcpy(&value, aData, sizeof(value));
+  return value;
+}
+
+static inline void write32(unsigned char *aData, uint32_t aValue)
+{
+  aData[0] = (unsigned char) aValue;
+  aData[1] = (unsigned char) (aValue >> 8);
+  aData[2] = (unsigned char) (aValue >> 16);
+  aData[3] = (unsigned char) (aValue >> 24);
+}
+
+/* Write the part of a length that does not fit in its nibble */
+static inline unsigned char *writeLength(unsigned char *aOutput, int aLength)
+{
+  aLength -= 15;
+  while (aLength >= 255) {
+    *aOutput++ = 255;
+    aLength -= 255;
+  }
+  *aOutput++ = (unsigned char) aLength;
+  return aOutput;
+}
+
+/* Read the part of a length that does not fit in its nibble.
+ * Returns false if the input ends before. */
+static inline bool readLength(const unsigned char *&aInput, const unsigned char *aEnd, int &aLength)
+{
+  unsigned char byte;
+  do {
+    if (aInput >= aEnd)
+      return false;
+    byte = *aInput++;
+    aLength += byte;
+  } while (byte == 255);
+  return true;
+}
+
+static unsigned char *writeSequence(unsigned char *aOutput, const unsigned char *aLiterals,
+                                    int aLiteralLength, int aOffset, int aMatchLength)
+{
+  int matchCode = aMatchLength - COMPRESSION_MIN_MATCH;
+  unsigned char *token = aOutput++;
+  *token = (unsigned char) (((aLiteralLength < 15 ? aLiteralLength : 15) << 4) |
+                            (matchCode < 15 ? matchCode : 15));
+  if (aLiteralLength >= 15)
+    aOutput = writeLength(aOutput, aLiteralLength);
+  memcpy(aOutput, aLiterals, aLiteralLength);
+  aOutput += aLiteralLength;
+
+  if (aOffset > 0) {
+    *aOutput++ = (unsigned char) aOffset;
+    *aOutput++ = (unsigned char) (aOffset >> 8);
+    if (matchCode >= 15)
+      aOutput = writeLength(aOutput, matchCode);
+  }
+  return aOutput;
+}
+
+/*
+ * CompressionHistory methods
+ */
+CompressionHistory::CompressionHistory()
+{
+  mHistory = 0;
+  mLength = mSize = 0;
+}
+
+CompressionHistory::~CompressionHistory()
+{
+  if (mHistory != 0)
+    free(mHistory);
+}
+
+/* Make room for aLength more bytes, keeping at least the last window.
+ * Returns the number of bytes that were dropped from the start.
+ */
+int CompressionHistory::prepare(int aLength)
+{
+  int shift = 0;
+  if (mLength + aLength > mSize && mLength > COMPRESSION_WINDOW)
+  {
+    shift = mLength - COMPRESSION_WINDOW;
+    memmove(mHistory, mHistory + shift, COMPRESSION_WINDOW);
+    mLength = COMPRESSION_WINDOW;
+  }
+
+  if (mLength + aLength > mSize)
+  {
+    int size = ((mLength + aLength) / COMPRESSION_WINDOW + 2) * COMPRESSION_WINDOW;
+    mHistory = (char *) realloc(mHistory, size);
+    mSize = size;
+  }
+
+  return shift;
+}
+
+/*
+ * Compressor methods
+ */
+Compressor::Compressor()
+{
+  for (int i = 0; i < (1 << COMPRESSION_HASH_BITS); i++)
+    mTable[i] = -1;
+  mOutput = 0;
+  mOutputSize = 0;
+}
+
+Compressor::~Compressor()
+{
+  if (mOutput != 0)
+    free(mOutput);
+}
+
+const char *Compressor::compress(const char *aData, int aLength, int &aFrameLength)
+{
+  int shift = prepare(aLength);
+  if (shift > 0)
+  {
+    for (int i = 0; i < (1 << COMPRESSION_HASH_BITS); i++)
+      mTable[i] = (mTable[i] >= shift) ? mTable[i] - shift : -1;
+  }
+
+  int start = mLength;
+  int end = start + aLength;
+  memcpy(mHistory + start, aData, aLength);
+  mLength = end;
+
+  int maxLength = COMPRESSION_HEADER_LEN + aLength + aLength / 255 + 16;
+  if (maxLength > mOutputSize)
+  {
+    mOutput = (char *) realloc(mOutput, maxLength);
+    mOutputSize = maxLength;
+  }
+
+  const unsigned char *history = (const unsigned char *) mHistory;
+  unsigned char *output = (unsigned char *) mOutput + COMPRESSION_HEADER_LEN;
+  int anchor = start;
+  int pos = start;
+  while (pos + COMPRESSION_MIN_MATCH <= end)
+  {
+    uint32_t sequence = read32(history + pos);
+    uint32_t hash = (sequence * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+    int candidate = mTable[hash];
+    mTable[hash] = pos;
+
+    if (candidate >= 0 && pos - candidate <= COMPRESSION_WINDOW &&
+        read32(history + candidate) == sequence)
+    {
+      int length = COMPRESSION_MIN_MATCH;
+      while (pos + length < end && history[candidate + length] == history[pos + length])
+        length++;
+
+      output = writeSequence(output, history + anchor, pos - anchor, pos - candidate, length);
+      pos += length;
+      anchor = pos;
+    }
+    else
+      pos++;
+  }
+  output = writeSequence(output, history + anchor, end - anchor, 0, COMPRESSION_MIN_MATCH);
+
+  aFrameLength = (int) ((char *) output - mOutput);
+  write32((unsigned char *) mOutput, (uint32_t) (aFrameLength - COMPRESSION_HEADER_LEN));
+  write32((unsigned char *) mOutput + 4, (uint32_t) aLength);
+  return mOutput;
+}
+
+/*
+ * Decompressor methods
+ */
+const char *Decompressor::decompress(const char *aData, int aLength, int aPlainLength)
+{
+  prepare(aPlainLength);
+
+  unsigned char *history = (unsigned char *) mHistory;
+  unsigned char *output = history + mLength;
+  unsigned char *outputEnd = output + aPlainLength;
+  const unsigned char *input = (const unsigned char *) aData;
+  const unsigned char *inputEnd = input + aLength;
+
+  while (input < inputEnd)
+  {
+    int token = *input++;
+    int literals = token >> 4;
+    if (literals == 15 && !readLength(input, inputEnd, literals))
+      return 0;
+    if (literals > inputEnd - input || literals > outputEnd - output)
+      return 0;
+    memcpy(output, input, literals);
+    output += literals;
+    input += literals;
+
+    if (input == inputEnd)
+      break;
+
+    if (inputEnd - input < 2)
+      return 0;
+    int offset = input[0] | (input[1] << 8);
+    input += 2;
+    int length = token & 15;
+    if (length == 15 && !readLength(input, inputEnd, length))
+      return 0;
+    length += COMPRESSION_MIN_MATCH;
+
+    if (offset == 0 || offset > output - history || length > outputEnd - output)
+      return 0;
+    /* The match may overlap the output: copy byte by byte */
+    const unsigned char *match = output - offset;
+    for (int i = 0; i < length; i++)
+      output[i] = match[i];
+    output += length;
+  }
+
+  if (output != outputEnd)
+    return 0;
+
+  const char *frame = mHistory + mLength;
+  mLength += aPlainLength;
+  return frame;
+}
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef COMPRESSOR_HPP
+#define COMPRESSOR_HPP
+
+/*
+ * Streaming LZ77 compression of the SHDR frames, for the clients on slow
+ * links. Each frame (one cycle) is compressed on its own and can be decoded
+ * as soon as it is received, but the matches may refer to the previous
+ * frames: the data item names and most of the values repeat from one cycle
+ * to the next, which is where the gain comes from.
+ *
+ * Frame: compressed length (4 bytes, little endian), plain length (4 bytes,
+ * little endian), then the sequences. A sequence is a token (high nibble:
+ * literal length, low nibble: match length - MIN_MATCH, 15 meaning that
+ * bytes of 255 and a last byte smaller than 255 follow), the literals, and,
+ * except for the last sequence of the frame, the match offset (2 bytes,
+ * little endian). The last sequence has only literals.
+ */
+
+const int COMPRESSION_WINDOW = 65535;  /* Maximum match offset */
+const int COMPRESSION_HASH_BITS = 12;
+const int COMPRESSION_MIN_MATCH = 4;
+const int COMPRESSION_HEADER_LEN = 8;
+
+/* Plain history shared by the compressor and the decompressor */
+class CompressionHistory
+{
+protected:
+  char *mHistory;       /* Plain data of the previous frames then of the current one */
+  int mLength;
+  int mSize;
+
+  int prepare(int aLength);
+
+public:
+  CompressionHistory();
+  ~CompressionHistory();
+};
+
+class Compressor : public CompressionHistory
+{
+protected:
+  int mTable[1 << COMPRESSION_HASH_BITS]; /* Last position in mHistory of each hash */
+  char *mOutput;
+  int mOutputSize;
+
+public:
+  Compressor();
+  ~Compressor();
+
+  /* Return the complete frame to send, its length in aLength */
+  const char *compress(const char *aData, int aLength, int &aFrameLength);
+};
+
+/* Reference decoder for the clients */
+class Decompressor : public CompressionHistory
+{
+public:
+  /* Decode the sequences of a frame without its header. Returns the plain
+   * frame, valid until the next call, or 0 if the data is corrupted. */
+  const char *decompress(const char *aData, int aLength, int aPlainLength);
+};
+
+#endif
@@ -0,0 +1,183 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "cycle_scheduler.hpp"
+#include "logger.hpp"
+#include "clock.hpp"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+CycleScheduler::CycleScheduler(CycleTask *aTask, int aPeriod)
+{
+  mTask = aTask;
+  mPeriod = (aPeriod > 0) ? aPeriod : 1;
+  mRunning = false;
+  mStarted = false;
+  mTicks = 0;
+  mOverruns = 0;
+  mMaxLateness = 0;
+#ifdef WIN32
+  mThread = 0;
+  mTimer = 0;
+#endif
+}
+
+CycleScheduler::~CycleScheduler()
+{
+  stop();
+}
+
+bool CycleScheduler::start()
+{
+  if (mStarted)
+    return true;
+
+  mRunning = true;
+#ifdef WIN32
+  /* The high resolution timers are not available before Windows 10 1803 */
+  mTimer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                  TIMER_ALL_ACCESS);
+  if (mTimer == 0)
+    mTimer = CreateWaitableTimer(0, TRUE, 0);
+  mThread = CreateThread(0, 0, threadMain, this, 0, 0);
+  mStarted = (mThread != 0);
+#else
+  mStarted = (pthread_create(&mThread, 0, threadMain, this) == 0);
+#endif
+  if (!mStarted)
+  {
+    mRunning = false;
+    gLogger->error("Could not start the cycle scheduler");
+  }
+  return mStarted;
+}
+
+/* Wait for the tick in progress, if any, to complete */
+void CycleScheduler::stop()
+{
+  if (!mStarted)
+    return;
+
+  mRunning = false;
+#ifdef WIN32
+  WaitForSingleObject(mThread, INFINITE);
+  CloseHandle(mThread);
+  if (mTimer != 0)
+    CloseHandle(mTimer);
+  mThread = 0;
+  mTimer = 0;
+#else
+  pthread_join(mThread, 0);
+#endif
+  mStarted = false;
+}
+
+#ifdef WIN32
+DWORD WINAPI CycleScheduler::threadMain(LPVOID aScheduler)
+{
+  ((CycleScheduler *) aScheduler)->run();
+  return 0;
+}
+#else
+void *CycleScheduler::threadMain(void *aScheduler)
+{
+  ((CycleScheduler *) aScheduler)->run();
+  return 0;
+}
+#endif
+
+void CycleScheduler::run()
+{
+  double period = mPeriod / 1000.0;
+  double deadline = monotonicNow() + period;
+
+  while (mRunning)
+  {
+    sleepUntil(deadline);
+    if (!mRunning)
+      break;
+
+    double lateness = monotonicNow() - deadline;
+    if (lateness > 0.0 && lateness * 1e6 > mMaxLateness)
+      mMaxLateness = (unsigned int) (lateness * 1e6);
+
+    mTask->tick();
+    mTicks++;
+
+    /* The next deadline is relative to the previous one, not to the end of
+     * this tick. The deadlines that already passed are skipped. */
+    deadline += period;
+    double late = monotonicNow() - deadline;
+    if (late > 0.0)
+    {
+      unsigned int missed = (unsigned int) (late / period) + 1;
+      deadline += missed * period;
+      if (mOverruns == 0 || (mOverruns / 100) != ((mOverruns + missed) / 100))
+        gLogger->warning("Cycle overrun: %d ticks of %d ms skipped (%d so far)",
+          missed, mPeriod, mOverruns + missed);
+      mOverruns += missed;
+    }
+  }
+}
+
+/* Sleep until aDeadline, on the monotonic clock of now */
+void CycleScheduler::sleepUntil(double aDeadline)
+{
+  double remaining = aDeadline - monotonicNow();
+  if (remaining <= 0.0)
+    return;
+
+#ifdef WIN32
+  if (mTimer != 0)
+  {
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG) (remaining * 1e7); /* Relative, in 100 ns */
+    if (SetWaitableTimer(mTimer, &due, 0, 0, 0, FALSE))
+    {
+      WaitForSingleObject(mTimer, INFINITE);
+      return;
+    }
+  }
+  Sleep((DWORD) (remaining * 1000.0));
+#else
+  struct timespec ts;
+  ts.tv_sec = (time_t) aDeadline;
+  ts.tv_nsec = (long) ((aDeadline - (double) ts.tv_sec) * 1e9);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR)
+    ;
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef CYCLE_SCHEDULER_HPP
+#define CYCLE_SCHEDULER_HPP
+
+/* What the scheduler runs at each tick */
+class CycleTask
+{
+public:
+  virtual ~CycleTask() { }
+  virtual void tick() = 0;
+};
+
+/*
+ * Runs a task at a fixed period from its own thread, whatever the time the
+ * acquisition takes.
+ *
+ * The ticks are due at absolute deadlines, start + n * period, so a tick
+ * that wakes up late does not delay the following ones. A tick that ends
+ * after one or more of the following deadlines is an overrun: the missed
+ * ticks are skipped, not run in a burst, and counted.
+ */
+class CycleScheduler
+{
+protected:
+  CycleTask *mTask;
+  int mPeriod;                   /* ms */
+  volatile bool mRunning;
+  bool mStarted;
+#ifdef WIN32
+  HANDLE mThread;
+  HANDLE mTimer;
+  static DWORD WINAPI threadMain(LPVOID aScheduler);
+#else
+  pthread_t mThread;
+  static void *threadMain(void *aScheduler);
+#endif
+
+  void run();
+  void sleepUntil(double aDeadline);
+
+public:
+  volatile unsigned int mTicks;
+  volatile unsigned int mOverruns;   /* Ticks that were skipped */
+  volatile unsigned int mMaxLateness; /* Worst lateness of a tick, in microseconds */
+
+  CycleScheduler(CycleTask *aTask, int aPeriod);
+  ~CycleScheduler();
+
+  bool start();
+  void stop();
+  bool running() { return mStarted; }
+
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "device_datum.hpp"
+#include "datum_arena.hpp"
+
+DatumArena::DatumArena()
+{
+  mChunks = 0;
+  mData = 0;
+  mCount = mSize = 0;
+}
+
+DatumArena::~DatumArena()
+{
+  while (mCount > 0)
+    mData[--mCount]->~DeviceDatum();
+
+  while (mChunks != 0)
+  {
+    Chunk *next = mChunks->mNext;
+    free(mChunks);
+    mChunks = next;
+  }
+  if (mData != 0)
+    free(mData);
+}
+
+/* Make room in the list of the values for one more */
+void DatumArena::reserve()
+{
+  if (mCount < mSize)
+    return;
+
+  int size = (mSize == 0) ? 64 : mSize * 2;
+  DeviceDatum **data = (DeviceDatum**) realloc(mData, size * sizeof(DeviceDatum*));
+  if (data == 0)
+    throw std::bad_alloc();
+  mData = data;
+  mSize = size;
+}
+
+/* Take aSize bytes from the current chunk, or from a new one if it is too
+ * full. A value larger than a chunk gets a chunk of its own. */
+void *DatumArena::allocate(size_t aSize)
+{
+  size_t header = (sizeof(Chunk) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+  size_t size = (aSize + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+  if (mChunks == 0 || mChunks->mUsed + size > mChunks->mSize)
+  {
+    size_t chunkSize = header + size;
+    if (chunkSize < (size_t) ARENA_CHUNK_SIZE)
+      chunkSize = ARENA_CHUNK_SIZE;
+    Chunk *chunk = (Chunk*) malloc(chunkSize);
+    if (chunk == 0)
+      throw std::bad_alloc();
+    chunk->mNext = mChunks;
+    chunk->mSize = chunkSize;
+    chunk->mUsed = header;
+    mChunks = chunk;
+  }
+
+  void *memory = (char*) mChunks + mChunks->mUsed;
+  mChunks->mUsed += size;
+  return memory;
+}
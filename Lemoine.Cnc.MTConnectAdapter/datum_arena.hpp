@@ -0,0 +1,93 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef DATUM_ARENA_HPP
+#define DATUM_ARENA_HPP
+
+#include <new>
+
+class DeviceDatum;
+
+/* Size of the chunks the data values are constructed in */
+const int ARENA_CHUNK_SIZE = 16 * 1024;
+const int ARENA_ALIGN = 8; /* Enough for the doubles of the values, as malloc */
+
+/*
+ * The storage of the data values of an adapter.
+ *
+ * The data values are constructed one after the other in large chunks, in
+ * the order they are created, which is usually the order they are
+ * registered and sent in. The arena owns them: they are all destroyed at
+ * once with it, after the adapter stopped sending them, so that no
+ * registered value can be deleted behind the adapter's back.
+ *
+ * The list of the values to destroy grows with the number of values that
+ * are actually created. As new, the arena throws std::bad_alloc when the
+ * memory is exhausted.
+ */
+class DatumArena
+{
+protected:
+  struct Chunk
+  {
+    Chunk *mNext;
+    size_t mSize;
+    size_t mUsed;
+  };
+
+  Chunk *mChunks;      /* The current chunk first */
+  DeviceDatum **mData; /* To destroy them in reverse order */
+  int mCount;
+  int mSize;
+
+  void *allocate(size_t aSize);
+  void reserve();
+
+public:
+  DatumArena();
+  ~DatumArena();
+
+  /* Construct a data value in the arena */
+  template <class T> T *create(const char *aName)
+  {
+    reserve();
+    T *datum = new (allocate(sizeof(T))) T(aName);
+    mData[mCount++] = datum;
+    return datum;
+  }
+
+  int count() { return mCount; }
+};
+
+#endif
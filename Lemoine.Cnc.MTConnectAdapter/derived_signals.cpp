@@ -0,0 +1,247 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "device_datum.hpp"
+#include "derived_signals.hpp"
+#include "clock.hpp"
+
+/* Set the value of a node, returns true if it changed */
+static bool update(double &aValue, bool &aAvailable, double aNewValue, bool aNewAvailable)
+{
+  if (aAvailable == aNewAvailable && aValue == aNewValue)
+    return false;
+  aValue = aNewValue;
+  aAvailable = aNewAvailable;
+  return true;
+}
+
+DerivedSignals::DerivedSignals()
+{
+  mNumNodes = 0;
+}
+
+/* The inputs must be nodes that already exist, so the graph has no cycle */
+int DerivedSignals::addNode(EOperator aOperator, const int *aInputs, int aNumInputs,
+                            double aParameter, Sample *aSample)
+{
+  if (mNumNodes >= MAX_DERIVED_NODES || aNumInputs > MAX_NODE_INPUTS)
+    return -1;
+  if (aOperator == eINPUT ? aSample == 0 : aNumInputs < 1)
+    return -1;
+  for (int i = 0; i < aNumInputs; i++)
+  {
+    if (aInputs[i] < 0 || aInputs[i] >= mNumNodes)
+      return -1;
+  }
+
+  Node &node = mNodes[mNumNodes];
+  node.mOperator = aOperator;
+  for (int i = 0; i < aNumInputs; i++)
+  {
+    node.mInputs[i] = aInputs[i];
+    node.mInputVersions[i] = 0;
+    node.mPrevious[i] = 0.0;
+  }
+  node.mNumInputs = aNumInputs;
+  node.mParameter = aParameter;
+  node.mSample = aSample;
+  node.mValue = 0.0;
+  node.mAvailable = false;
+  node.mVersion = 0;
+  node.mPreviousTime = 0.0;
+  node.mStarted = false;
+  return mNumNodes++;
+}
+
+int DerivedSignals::input(Sample *aSample)
+{
+  return addNode(eINPUT, 0, 0, 0.0, aSample);
+}
+
+int DerivedSignals::rate(const int *aInputs, int aNumInputs, double aScale, Sample *aOutput)
+{
+  return addNode(eRATE, aInputs, aNumInputs, aScale, aOutput);
+}
+
+int DerivedSignals::norm(const int *aInputs, int aNumInputs, Sample *aOutput)
+{
+  return addNode(eNORM, aInputs, aNumInputs, 0.0, aOutput);
+}
+
+int DerivedSignals::sum(const int *aInputs, int aNumInputs, Sample *aOutput)
+{
+  return addNode(eSUM, aInputs, aNumInputs, 0.0, aOutput);
+}
+
+int DerivedSignals::threshold(int aInput, double aLevel, Sample *aOutput)
+{
+  return addNode(eTHRESHOLD, &aInput, 1, aLevel, aOutput);
+}
+
+int DerivedSignals::timer(int aInput, Sample *aOutput)
+{
+  return addNode(eTIMER, &aInput, 1, 0.0, aOutput);
+}
+
+/* Compute again the nodes whose inputs changed, and set their output
+ * samples. Returns the number of output samples that were set. */
+int DerivedSignals::evaluate(double aNow)
+{
+  int outputs = 0;
+  for (int i = 0; i < mNumNodes; i++)
+  {
+    Node &node = mNodes[i];
+    if (!compute(node, aNow))
+      continue;
+
+    node.mVersion++;
+    if (node.mOperator != eINPUT && node.mSample != 0)
+    {
+      if (node.mAvailable)
+        node.mSample->setValue(node.mValue);
+      else
+        node.mSample->unavailable();
+      outputs++;
+    }
+  }
+  return outputs;
+}
+
+/* Returns true if the value of the node changed */
+bool DerivedSignals::compute(Node &aNode, double aNow)
+{
+  if (aNode.mOperator == eINPUT)
+  {
+    Sample *sample = aNode.mSample;
+    unsigned int version = sample->version();
+    if (aNode.mStarted && version == aNode.mInputVersions[0])
+      return false;
+    aNode.mStarted = true;
+    aNode.mInputVersions[0] = version;
+    return update(aNode.mValue, aNode.mAvailable, sample->getValue(),
+                  sample->hasInitialValue() && !sample->isUnavailable());
+  }
+
+  /* Only the values that depend on the time are computed without a change
+   * of their inputs */
+  bool dirty = (aNode.mOperator == eRATE && aNode.mValue != 0.0) ||
+    (aNode.mOperator == eTIMER && aNode.mStarted && aNode.mPrevious[0] != 0.0);
+  bool available = true;
+  for (int i = 0; i < aNode.mNumInputs; i++)
+  {
+    Node &input = mNodes[aNode.mInputs[i]];
+    if (input.mVersion != aNode.mInputVersions[i])
+    {
+      aNode.mInputVersions[i] = input.mVersion;
+      dirty = true;
+    }
+    available = available && input.mAvailable;
+  }
+  if (!dirty)
+  {
+    /* A rate that stays null was still measured at this time */
+    if (aNode.mOperator == eRATE)
+      aNode.mPreviousTime = aNow;
+    return false;
+  }
+
+  if (!available)
+  {
+    /* A rate or a timer starts again once its inputs are back */
+    aNode.mStarted = false;
+    return update(aNode.mValue, aNode.mAvailable, aNode.mValue, false);
+  }
+
+  double value = 0.0;
+  switch (aNode.mOperator)
+  {
+  case eSUM:
+    for (int i = 0; i < aNode.mNumInputs; i++)
+      value += mNodes[aNode.mInputs[i]].mValue;
+    break;
+
+  case eNORM:
+    for (int i = 0; i < aNode.mNumInputs; i++)
+    {
+      double x = mNodes[aNode.mInputs[i]].mValue;
+      value += x * x;
+    }
+    value = sqrt(value);
+    break;
+
+  case eTHRESHOLD:
+    value = (mNodes[aNode.mInputs[0]].mValue > aNode.mParameter) ? 1.0 : 0.0;
+    break;
+
+  case eTIMER:
+    value = aNode.mValue;
+    if (aNode.mStarted && aNode.mPrevious[0] != 0.0)
+      value += aNow - aNode.mPreviousTime;
+    aNode.mPrevious[0] = mNodes[aNode.mInputs[0]].mValue;
+    aNode.mPreviousTime = aNow;
+    aNode.mStarted = true;
+    break;
+
+  case eRATE:
+    if (aNode.mStarted)
+    {
+      double elapsed = aNow - aNode.mPreviousTime;
+      if (elapsed <= 0.0)
+        return false;
+      if (aNode.mNumInputs == 1)
+        value = mNodes[aNode.mInputs[0]].mValue - aNode.mPrevious[0];
+      else
+      {
+        for (int i = 0; i < aNode.mNumInputs; i++)
+        {
+          double delta = mNodes[aNode.mInputs[i]].mValue - aNode.mPrevious[i];
+          value += delta * delta;
+        }
+        value = sqrt(value);
+      }
+      value = value / elapsed * aNode.mParameter;
+    }
+    for (int i = 0; i < aNode.mNumInputs; i++)
+      aNode.mPrevious[i] = mNodes[aNode.mInputs[i]].mValue;
+    aNode.mPreviousTime = aNow;
+    aNode.mStarted = true;
+    break;
+
+  default:
+    return false;
+  }
+
+  return update(aNode.mValue, aNode.mAvailable, value, true);
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef DERIVED_SIGNALS_HPP
+#define DERIVED_SIGNALS_HPP
+
+class Sample;
+
+/* Capacity of the derivation graph of an adapter */
+const int MAX_DERIVED_NODES = 64;
+const int MAX_NODE_INPUTS = 8;
+
+/*
+ * Values derived natively from the samples of an adapter, such as a
+ * feedrate from the axis positions or a running time.
+ *
+ * The nodes form a graph: the input nodes read a sample, the other ones
+ * apply an operator to the values of previous nodes, so the creation order
+ * is a valid evaluation order. A node is only computed again when one of
+ * its inputs changed since its previous computation, or while its value
+ * depends on the time (a rate that is not null, a running timer). The nodes
+ * with an output sample set it when their value changes.
+ *
+ * evaluate is called by the adapter once the changes of the samples of the
+ * cycle are detected.
+ */
+class DerivedSignals
+{
+public:
+  enum EOperator {
+    eINPUT,      /* The value of a sample */
+    eRATE,       /* Difference of the inputs over the time, norm of them if several */
+    eNORM,       /* Euclidean norm of the inputs */
+    eSUM,        /* Sum of the inputs */
+    eTHRESHOLD,  /* 1 if the input is above the parameter, else 0 */
+    eTIMER       /* Seconds the input was not null */
+  };
+
+protected:
+  struct Node
+  {
+    EOperator mOperator;
+    int mInputs[MAX_NODE_INPUTS];
+    unsigned int mInputVersions[MAX_NODE_INPUTS];
+    int mNumInputs;
+    double mParameter;    /* Scale of a rate, level of a threshold */
+    Sample *mSample;      /* Read by an input node, set by the other ones */
+
+    double mValue;
+    bool mAvailable;
+    unsigned int mVersion; /* Incremented each time the value changes */
+
+    double mPrevious[MAX_NODE_INPUTS]; /* The inputs at the previous computation */
+    double mPreviousTime;
+    bool mStarted;
+  };
+
+  Node mNodes[MAX_DERIVED_NODES];
+  int mNumNodes;
+
+  int addNode(EOperator aOperator, const int *aInputs, int aNumInputs, double aParameter,
+              Sample *aSample);
+  bool compute(Node &aNode, double aNow);
+
+public:
+  DerivedSignals();
+
+  /* Each method returns the index of the new node, or -1 if it can not be
+   * added. The output sample is optional. */
+  int input(Sample *aSample);
+  int rate(const int *aInputs, int aNumInputs, double aScale, Sample *aOutput = 0);
+  int norm(const int *aInputs, int aNumInputs, Sample *aOutput = 0);
+  int sum(const int *aInputs, int aNumInputs, Sample *aOutput = 0);
+  int threshold(int aInput, double aLevel, Sample *aOutput = 0);
+  int timer(int aInput, Sample *aOutput = 0);
+
+  double value(int aNode) { return mNodes[aNode].mValue; }
+  bool available(int aNode) { return mNodes[aNode].mAvailable; }
+
+  int evaluate(double aNow);
+};
+
+#endif
@@ -35,486 +35,603 @@
 #include "internal.hpp"
 #include "device_datum.hpp"
 #include "string_buffer.hpp"
+#include "binary_buffer.hpp"
+#include "sample_bank.hpp"
+#include "sanitizer.hpp"
+#include "atomic.hpp"
 
 static const char *sUnavailable = "UNAVAILABLE";
 
 /*
- * Data value methods.
+ * Fragment methods.
  */
-DeviceDatum::DeviceDatum(const char *aName)
-{
-  strncpy(mName, aName, NAME_LEN);
-  mName[NAME_LEN - 1] = '\0';
-  mChanged = false;
-  mHasValue = false;
-}
-
-DeviceDatum::~DeviceDatum()
+Fragment::Fragment()
 {
+  mText = 0;
+  mSize = 0;
+  mVersion = 0;
+  mValid = false;
 }
 
-bool DeviceDatum::append(StringBuffer &aBuffer)
+Fragment::Fragment(const Fragment &aOther)
 {
-  char buffer[1024];
-  aBuffer.append(toString(buffer, 1024));
-  mChanged = false;
-  return mChanged;
+  mText = 0;
+  mSize = 0;
+  mVersion = 0;
+  mValid = false;
 }
 
-bool DeviceDatum::hasInitialValue()
+Fragment::~Fragment()
 {
-  return mHasValue;
+  if (mText != 0)
+    free(mText);
 }
 
-bool DeviceDatum::requiresFlush()
+/* The text of aOther may be formatted again at the same time: only the
+ * cache of this fragment is invalidated, its memory is kept */
+Fragment &Fragment::operator=(const Fragment &aOther)
 {
-  return false;
+  mValid = false;
+  return *this;
 }
 
-void DeviceDatum::appendText(char *aBuffer, char *aValue, unsigned int aMaxLen)
+void Fragment::set(const char *aText, unsigned int aVersion)
 {
-  size_t len = strlen(aBuffer);
-  size_t max = aMaxLen - len;
-  char *cp = aValue, *dp = aBuffer + len;
-  for (size_t i = len; i < aMaxLen && *cp != '\0'; i++)
+  int length = (int) strlen(aText);
+  if (length >= mSize)
   {
-    if (*cp == '\n' || *cp == '\r')
-      *dp = ' ';
-    else
-      *dp = *cp;
-    dp++; cp++;
+    int size = ((length / 64) + 1) * 64;
+    char *text = (char*) malloc(size);
+    if (mText != 0)
+      free(mText);
+    mText = text;
+    mSize = size;
   }
-  *dp = '\0';
+  memcpy(mText, aText, length + 1);
+  mVersion = aVersion;
+  mValid = true;
 }
 
 /*
- * Event methods
+ * TextField methods.
  */
-Event::Event(const char* aName) :
-  DeviceDatum(aName)
+TextField::TextField()
 {
-  mValue[0] = 0;
+  mText[0] = '\0';
+  mLength = 0;
 }
 
-bool Event::setValue(const char *aValue)
+/* Is the text, truncated to the capacity of a field, the current one ? */
+bool TextField::equals(const char *aText) const
 {
-  if (strncmp(aValue, mValue, EVENT_VALUE_LEN) != 0 || !mHasValue)
+  int i = 0;
+  while (i < mLength && aText[i] == mText[i])
+    i++;
+  return i == mLength && (aText[i] == '\0' || i == EVENT_VALUE_LEN - 1);
+}
+
+/* Copy the text, truncated to the capacity of a field */
+void TextField::set(const char *aText)
+{
+  int length = 0;
+  while (length < EVENT_VALUE_LEN - 1 && aText[length] != '\0')
   {
-    mChanged = true;
-    strncpy(mValue, aValue, EVENT_VALUE_LEN);
-    mValue[EVENT_VALUE_LEN - 1] = '\0';
-    mHasValue = true;
+    mText[length] = aText[length];
+    length++;
   }
-  return mChanged;
+  mText[length] = '\0';
+  mLength = length;
 }
 
-char *Event::toString(char *aBuffer, int aMaxLen)
+/*
+ * DatumName methods.
+ */
+DatumName::DatumName(const char *aItem)
 {
-  snprintf(aBuffer, aMaxLen, "|%s|", mName);
-  appendText(aBuffer, mValue, aMaxLen);
-  return aBuffer;
+  strncpy(mItem, aItem, NAME_LEN);
+  mItem[NAME_LEN - 1] = '\0';
+  mPrefixed = 0;
+  mLength = (int) strlen(mItem);
 }
 
-bool Event::unavailable()
+DatumName::DatumName(const DatumName &aOther)
 {
-  return setValue(sUnavailable);
+  memcpy(mItem, aOther.mItem, NAME_LEN);
+  mPrefixed = (aOther.mPrefixed != 0) ? strdup(aOther.mPrefixed) : 0;
+  mLength = aOther.mLength;
 }
 
-/*
- * IntEvent methods
- */
-IntEvent::IntEvent(const char *aName)
-  : DeviceDatum(aName)
+DatumName::~DatumName()
 {
-  mValue = 0;
-  mUnavailable = false;
+  if (mPrefixed != 0)
+    free(mPrefixed);
 }
 
-bool IntEvent::setValue(int aValue)
+/* The copies of a value are committed at each cycle: the prefixed name is
+ * only allocated again if it differs */
+DatumName &DatumName::operator=(const DatumName &aOther)
 {
-  if (aValue !=  mValue || !mHasValue || mUnavailable)
+  if (this == &aOther)
+    return *this;
+  memcpy(mItem, aOther.mItem, NAME_LEN);
+  mLength = aOther.mLength;
+  if (aOther.mPrefixed == 0 ||
+      mPrefixed == 0 || strcmp(mPrefixed, aOther.mPrefixed) != 0)
   {
-    mChanged = true;
-    mValue = aValue;
-    mHasValue = true;
-    mUnavailable = false;
+    if (mPrefixed != 0)
+      free(mPrefixed);
+    mPrefixed = (aOther.mPrefixed != 0) ? strdup(aOther.mPrefixed) : 0;
   }
-  
-  return mChanged;
-}
-
-char *IntEvent::toString(char *aBuffer, int aMaxLen)
-{
-  if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
-  else
-    snprintf(aBuffer, aMaxLen, "|%s|%d", mName, mValue);
-
-  return aBuffer;
+  return *this;
 }
 
-bool IntEvent::unavailable()
+/* Prefix the item name with a device name, or remove the prefix if aDevice
+ * is empty */
+void DatumName::prefix(const char *aDevice)
 {
-  if (!mUnavailable)
+  if (mPrefixed != 0)
+    free(mPrefixed);
+  mPrefixed = 0;
+  if (aDevice != 0 && aDevice[0] != '\0')
   {
-    mChanged = true;
-    mUnavailable = true;
+    size_t length = strlen(aDevice) + 1 + strlen(mItem);
+    mPrefixed = (char *) malloc(length + 1);
+    sprintf(mPrefixed, "%s:%s", aDevice, mItem);
   }
-  
-  return mChanged;
+  mLength = (int) strlen(text());
 }
 
 /*
- * Sample methods
+ * Data value methods.
  */
-Sample::Sample(const char *aName)
-  : DeviceDatum(aName)
+DeviceDatum::DeviceDatum(const char *aName)
+  : mName(aName)
 {
-  mValue = 0.0;
-  mUnavailable = false;
+  mChanged = false;
+  mSequence = 0;
+  mVersion = 0;
+  mHasValue = false;
+  mCycle = 0;
 }
- 
-bool Sample::setValue(double aValue)
+
+DeviceDatum::~DeviceDatum()
 {
-  if (fabs(aValue - mValue) > 0.000001 || !mHasValue ||
-      mUnavailable)
-  {
-      mChanged = true;
-      mValue = aValue;
-      mHasValue = true;
-      mUnavailable = false;
-  }
-  return mChanged;
 }
 
-char *Sample::toString(char *aBuffer, int aMaxLen)
+/* Prefix the name with a device name, as "device:name", for the adapters
+ * that share the same port */
+void DeviceDatum::prefixName(const char *aDevice)
 {
-  if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
-  else
-    snprintf(aBuffer, aMaxLen, "|%s|%.10f", mName, mValue);
-  return aBuffer;
+  mName.prefix(aDevice);
+  mFragment.mValid = false;
 }
 
-bool Sample::unavailable()
+/* Format the data value with the text of aIndex in its vocabulary */
+char *DeviceDatum::formatText(char *aBuffer, int aMaxLen, const EnumText *aTexts,
+                              int aCount, int aIndex)
 {
-  if (!mUnavailable)
+  static const EnumText empty = ENUM_TEXT("");
+  const EnumText &text = (0 <= aIndex && aIndex < aCount) ? aTexts[aIndex] : empty;
+
+  /* |name|text and the terminating null character */
+  if (mName.length() + text.mLength + 3 > aMaxLen)
   {
-    mChanged = true;
-    mUnavailable = true;
+    snprintf(aBuffer, aMaxLen, "|%s|%s", mName.text(), text.mText);
+    return aBuffer;
   }
-  
-  return mChanged;
-}
-
 
-/* Power */
+  char *cp = aBuffer;
+  *cp++ = '|';
+  memcpy(cp, mName.text(), mName.length());
+  cp += mName.length();
+  *cp++ = '|';
+  memcpy(cp, text.mText, text.mLength + 1);
+  return aBuffer;
+}
 
-bool PowerState::setValue(enum EPowerState aState)
+/* Start writing the value: wait for another setter, if any, then make the
+ * sequence odd */
+void DeviceDatum::beginWrite()
 {
-  if (mState != aState || !mHasValue)
+  for (;;)
   {
-    mState = aState;
-    mChanged = true;
-    mHasValue = true;
+    uint32_t sequence = atomicLoad32((volatile uint32_t *) &mSequence);
+    if ((sequence & 1) == 0 &&
+        atomicCompareExchange32((volatile uint32_t *) &mSequence, sequence, sequence + 1))
+      return;
   }
-  return mChanged;
 }
 
-char *PowerState::toString(char *aBuffer, int aMaxLen)
+void DeviceDatum::endWrite()
 {
-  const char *text;
-  switch(mState)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eON: text = "ON"; break;
-  case eOFF: text = "OFF"; break;
-  default: text = ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  atomicIncrement32((volatile uint32_t *) &mSequence);
 }
 
-bool PowerState::unavailable()
+/* Clear the changed flag before the value is read: a value set meanwhile
+ * is sent again at the next cycle */
+void DeviceDatum::reset()
 {
-  return setValue(eUNAVAILABLE);
+  atomicExchange32((volatile uint32_t *) &mChanged, 0);
 }
 
-/* Execution */
-
-bool Execution::setValue(enum EExecutionState aState)
+/* The SHDR fragment of the value, consistent even if the value is set at
+ * the same time. It is only formatted again once the value changed. */
+const char *DeviceDatum::fragment()
 {
-  if (mState != aState || !mHasValue)
+  for (;;)
   {
-    mState = aState;
-    mChanged = true;
-    mHasValue = true;
+    uint32_t sequence = atomicLoad32((volatile uint32_t *) &mSequence);
+    if (sequence & 1)
+      continue;
+    unsigned int version = mVersion;
+    if (mFragment.mValid && mFragment.mVersion == version)
+      return mFragment.text();
+
+    char buffer[1024];
+    toString(buffer, 1024);
+    atomicFence();
+    if (atomicLoad32((volatile uint32_t *) &mSequence) == sequence)
+    {
+      mFragment.set(buffer, version);
+      return mFragment.text();
+    }
   }
-  
-  return mChanged;
 }
 
-char *Execution::toString(char *aBuffer, int aMaxLen)
+/* Copy the value into its committed generation, consistently, and clear
+ * the changed flag. The copy is changed until it is sent. */
+DeviceDatum *DeviceDatum::commit(DeviceDatum *aTarget)
 {
-  const char *text;
-  switch(mState)
+  reset();
+  for (;;)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eACTIVE: text = "ACTIVE"; break;
-  case eREADY: text = "READY"; break;
-  case eINTERRUPTED: text = "INTERRUPTED"; break;
-  case eSTOPPED: text = "STOPPED"; break;
-  default: text = ""; break;
+    uint32_t sequence = atomicLoad32((volatile uint32_t *) &mSequence);
+    if (sequence & 1)
+      continue;
+    aTarget = copy(aTarget);
+    atomicFence();
+    if (atomicLoad32((volatile uint32_t *) &mSequence) == sequence)
+      break;
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  aTarget->mSequence = 0;
+  aTarget->mChanged = 1;
+  return aTarget;
 }
 
-bool Execution::unavailable()
+bool DeviceDatum::append(StringBuffer &aBuffer)
 {
-  return setValue(eUNAVAILABLE);
+  reset();
+  aBuffer.append(fragment());
+  return changed();
 }
 
-/* ControllerMode */
+/* By default the binary value is the SHDR text that follows the name */
+unsigned char DeviceDatum::binaryType()
+{
+  return BINARY_TEXT;
+}
 
-char *ControllerMode::toString(char *aBuffer, int aMaxLen)
+/* A consistent writeBinary: what was written is discarded if the value was
+ * set at the same time */
+void DeviceDatum::appendBinary(BinaryBuffer &aBuffer, unsigned int aId)
 {
-  const char *text;
-  switch(mMode)
+  size_t length = aBuffer.length();
+  for (;;)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eSEMI_AUTOMATIC: text = "SEMI_AUTOMATIC"; break;
-  case eAUTOMATIC: text = "AUTOMATIC"; break;
-  case eMANUAL: text = "MANUAL"; break;
-  case eMANUAL_DATA_INPUT: text = "MANUAL_DATA_INPUT"; break;
-  default: text = ""; break;
+    uint32_t sequence = atomicLoad32((volatile uint32_t *) &mSequence);
+    if (sequence & 1)
+      continue;
+    writeBinary(aBuffer, aId);
+    atomicFence();
+    if (atomicLoad32((volatile uint32_t *) &mSequence) == sequence)
+      return;
+    aBuffer.truncate(length);
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
 }
 
-bool ControllerMode::setValue(enum EMode aMode)
+void DeviceDatum::writeBinary(BinaryBuffer &aBuffer, unsigned int aId)
 {
-  if (mMode != aMode || !mHasValue)
-  {
-    mMode = aMode;
-    mChanged = true;
-    mHasValue = true;
-  }
+  aBuffer.putId(aId, false);
+  aBuffer.putText(fragment() + mName.length() + 2);
+}
 
-  return mChanged;
+bool DeviceDatum::hasInitialValue()
+{
+  return mHasValue;
 }
 
-bool ControllerMode::unavailable()
+bool DeviceDatum::requiresFlush()
 {
-  return setValue(eUNAVAILABLE);
+  return false;
 }
 
-/* Direction */
+/* Append a free text to the aLength characters already formatted */
+void DeviceDatum::appendText(char *aBuffer, int aLength, const char *aValue, int aValueLength,
+                             int aMaxLen)
+{
+  /* The line was already truncated */
+  if (aLength < 0 || aLength >= aMaxLen)
+    return;
+  sanitizeText(aBuffer + aLength, aMaxLen - aLength - 1, aValue, aValueLength);
+}
 
-char *Direction::toString(char *aBuffer, int aMaxLen)
+/*
+ * Event methods
+ */
+Event::Event(const char* aName) :
+  DeviceDatum(aName)
 {
-  const char *text;
-  switch(mDirection)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eCLOCKWISE: text = "CLOCKWISE"; break;
-  case eCOUNTER_CLOCKWISE: text = "COUNTER_CLOCKWISE"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
 }
 
-bool Direction::setValue(enum ERotationDirection aDirection)
+bool Event::setValue(const char *aValue)
 {
-  if (mDirection != aDirection || !mHasValue)
+  beginWrite();
+  if (!mValue.equals(aValue) || !mHasValue)
   {
-    mDirection = aDirection;
-    mChanged = true;
+    setChanged();
+    mValue.set(aValue);
     mHasValue = true;
   }
+  endWrite();
 
   return mChanged;
 }
 
-bool Direction::unavailable()
+char *Event::toString(char *aBuffer, int aMaxLen)
 {
-  return setValue(eUNAVAILABLE);
+  int length = snprintf(aBuffer, aMaxLen, "|%s|", mName.text());
+  appendText(aBuffer, length, mValue.text(), mValue.length(), aMaxLen);
+  return aBuffer;
 }
 
-/* Emergency Stop */
+void Event::writeBinary(BinaryBuffer &aBuffer, unsigned int aId)
+{
+  aBuffer.putId(aId, false);
+  aBuffer.putText(mValue.text(), mValue.length());
+}
 
-char *EmergencyStop::toString(char *aBuffer, int aMaxLen)
+bool Event::unavailable()
 {
-  const char *text;
-  switch(mValue)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eTRIGGERED: text = "TRIGGERED"; break;
-  case eARMED: text = "ARMED"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  return setValue(sUnavailable);
+}
+
+/*
+ * IntEvent methods
+ */
+IntEvent::IntEvent(const char *aName)
+  : DeviceDatum(aName)
+{
+  mValue = 0;
+  mUnavailable = false;
 }
 
-bool EmergencyStop::setValue(enum EValues aValue)
+bool IntEvent::setValue(int aValue)
 {
-  if (mValue != aValue || !mHasValue)
+  beginWrite();
+  if (aValue !=  mValue || !mHasValue || mUnavailable)
   {
+    setChanged();
     mValue = aValue;
-    mChanged = true;
     mHasValue = true;
+    mUnavailable = false;
   }
+  endWrite();
 
   return mChanged;
 }
 
-bool EmergencyStop::unavailable()
+char *IntEvent::toString(char *aBuffer, int aMaxLen)
 {
-  return setValue(eUNAVAILABLE);
+  if (mUnavailable)
+    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName.text());
+  else
+    snprintf(aBuffer, aMaxLen, "|%s|%d", mName.text(), mValue);
+
+  return aBuffer;
 }
 
-/* Axis Coupling */
+unsigned char IntEvent::binaryType()
+{
+  return BINARY_INTEGER;
+}
 
-char *AxisCoupling::toString(char *aBuffer, int aMaxLen)
+void IntEvent::writeBinary(BinaryBuffer &aBuffer, unsigned int aId)
 {
-  const char *text;
-  switch(mValue)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eTANDEM: text = "TANDEM"; break;
-  case eSYNCHRONOUS: text = "SYNCHRONOUS"; break;
-  case eMASTER: text = "MASTER"; break;
-  case eSLAVE: text = "SLAVE"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  aBuffer.putId(aId, mUnavailable);
+  if (!mUnavailable)
+    aBuffer.putInteger(mValue);
 }
 
-bool AxisCoupling::setValue(enum EValues aValue)
+bool IntEvent::unavailable()
 {
-  if (mValue != aValue || !mHasValue)
+  beginWrite();
+  if (!mUnavailable)
   {
-    mValue = aValue;
-    mChanged = true;
-    mHasValue = true;
+    setChanged();
+    mUnavailable = true;
   }
+  endWrite();
+
   return mChanged;
 }
 
-bool AxisCoupling::unavailable()
+/*
+ * Sample methods
+ */
+Sample::Sample(const char *aName)
+  : DeviceDatum(aName)
 {
-  return setValue(eUNAVAILABLE);
+  mValue = 0.0;
+  mUnavailable = false;
+  mThreshold = 0.000001;
+  mBank = 0;
+  mSlot = -1;
 }
 
-/* Door State */
-
-char *DoorState::toString(char *aBuffer, int aMaxLen)
+/* Stage the values of this sample in a bank from now on, returns false if
+ * the bank is full */
+bool Sample::bind(SampleBank *aBank)
 {
-  const char *text;
-  switch(mValue)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eOPEN: text = "CLOSED"; break;
-  case eCLOSED: text = "OPEN"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  int slot = aBank->add(this, mThreshold);
+  if (slot < 0)
+    return false;
+
+  if (mHasValue)
+    aBank->set(slot, mValue);
+  if (mUnavailable)
+    aBank->setUnavailable(slot);
+  mSlot = slot;
+  mBank = aBank;
+  return true;
 }
 
-bool DoorState::setValue(enum EValues aValue)
+/* Once bound, the bank compares the values with the new threshold too */
+void Sample::setThreshold(double aThreshold)
 {
-  if (mValue != aValue || !mHasValue)
-  {
-    mValue = aValue;
-    mChanged = true;
-    mHasValue = true;
-  }
-  return mChanged;
+  mThreshold = aThreshold;
+  if (mBank != 0)
+    mBank->setThreshold(mSlot, aThreshold);
 }
 
-bool DoorState::unavailable()
+/* The copies are not bound to the bank: they never stage a value */
+DeviceDatum *Sample::copy(DeviceDatum *aTarget)
 {
-  return setValue(eUNAVAILABLE);
+  Sample *copy = static_cast<Sample *>(copyDatum(this, aTarget));
+  copy->mBank = 0;
+  copy->mSlot = -1;
+  return copy;
 }
 
-// Path Mode
-
-char *PathMode::toString(char *aBuffer, int aMaxLen)
+/* A new value was detected by the bank */
+void Sample::detected(double aValue, unsigned char aState)
 {
-  const char *text;
-  switch(mValue)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eINDEPENDENT: text = "INDEPENDENT"; break;
-  case eSYNCHRONOUS: text = "SYNCHRONOUS"; break;
-  case eMIRROR: text = "MIRROR"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  beginWrite();
+  mValue = aValue;
+  mUnavailable = (aState & SAMPLE_UNAVAILABLE) != 0;
+  if (aState & SAMPLE_HAS_VALUE)
+    mHasValue = true;
+  setChanged();
+  endWrite();
 }
-
-bool PathMode::setValue(enum EValues aValue)
+ 
+bool Sample::setValue(double aValue)
 {
-  if (mValue != aValue || !mHasValue)
+  /* The change is only marked by the next detection of the bank */
+  if (mBank != 0)
+    return mBank->set(mSlot, aValue);
+
+  beginWrite();
+  if (fabs(aValue - mValue) > mThreshold || !mHasValue ||
+      mUnavailable)
   {
-    mValue = aValue;
-    mChanged = true;
-    mHasValue = true;
+      setChanged();
+      mValue = aValue;
+      mHasValue = true;
+      mUnavailable = false;
   }
+  endWrite();
+
   return mChanged;
 }
 
-bool PathMode::unavailable()
+char *Sample::toString(char *aBuffer, int aMaxLen)
 {
-  return setValue(eUNAVAILABLE);
+  if (mUnavailable)
+    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName.text());
+  else
+    snprintf(aBuffer, aMaxLen, "|%s|%.10f", mName.text(), mValue);
+  return aBuffer;
 }
 
-// Rotary Mode
+unsigned char Sample::binaryType()
+{
+  return BINARY_DOUBLE;
+}
 
-char *RotaryMode::toString(char *aBuffer, int aMaxLen)
+void Sample::writeBinary(BinaryBuffer &aBuffer, unsigned int aId)
 {
-  const char *text;
-  switch(mValue)
-  {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eSPINDLE: text = "SPINDLE"; break;
-  case eINDEX: text = "INDEX"; break;
-  case eCONTOUR: text = "CONTOUR"; break;
-  default: ""; break;
-  }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+  aBuffer.putId(aId, mUnavailable);
+  if (!mUnavailable)
+    aBuffer.putDouble(mValue);
 }
 
-bool RotaryMode::setValue(enum EValues aValue)
+bool Sample::unavailable()
 {
-  if (mValue != aValue || !mHasValue)
+  if (mBank != 0)
+    return mBank->setUnavailable(mSlot);
+
+  beginWrite();
+  if (!mUnavailable)
   {
-    mValue = aValue;
-    mChanged = true;
-    mHasValue = true;
+    setChanged();
+    mUnavailable = true;
   }
+  endWrite();
+
   return mChanged;
 }
 
-bool RotaryMode::unavailable()
-{
-  return setValue(eUNAVAILABLE);
-}
+
+/* Vocabularies */
+
+#define ENUM_COUNT(traits) \
+  const int traits::sCount = sizeof(traits::sTexts) / sizeof(EnumText)
+
+const EnumText PowerStateValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("ON"), ENUM_TEXT("OFF")
+};
+ENUM_COUNT(PowerStateValues);
+
+const EnumText ExecutionValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("READY"), ENUM_TEXT("INTERRUPTED"),
+  ENUM_TEXT("STOPPED"), ENUM_TEXT("ACTIVE"), ENUM_TEXT("FEED_HOLD")
+};
+ENUM_COUNT(ExecutionValues);
+
+const EnumText ControllerModeValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("AUTOMATIC"), ENUM_TEXT("MANUAL"),
+  ENUM_TEXT("MANUAL_DATA_INPUT"), ENUM_TEXT("SEMI_AUTOMATIC")
+};
+ENUM_COUNT(ControllerModeValues);
+
+const EnumText DirectionValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("CLOCKWISE"), ENUM_TEXT("COUNTER_CLOCKWISE")
+};
+ENUM_COUNT(DirectionValues);
+
+const EnumText EmergencyStopValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("TRIGGERED"), ENUM_TEXT("ARMED")
+};
+ENUM_COUNT(EmergencyStopValues);
+
+const EnumText AxisCouplingValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("TANDEM"), ENUM_TEXT("SYNCHRONOUS"),
+  ENUM_TEXT("MASTER"), ENUM_TEXT("SLAVE")
+};
+ENUM_COUNT(AxisCouplingValues);
+
+const EnumText DoorStateValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("OPEN"), ENUM_TEXT("CLOSED")
+};
+ENUM_COUNT(DoorStateValues);
+
+const EnumText PathModeValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("INDEPENDENT"), ENUM_TEXT("SYNCHRONOUS"),
+  ENUM_TEXT("MIRROR")
+};
+ENUM_COUNT(PathModeValues);
+
+const EnumText RotaryModeValues::sTexts[] = {
+  ENUM_TEXT("UNAVAILABLE"), ENUM_TEXT("SPINDLE"), ENUM_TEXT("INDEX"),
+  ENUM_TEXT("CONTOUR")
+};
+ENUM_COUNT(RotaryModeValues);
 
 // Condition
 
 Condition::Condition(const char *aName) :
   DeviceDatum(aName), mLevel(eUNAVAILABLE)
 {
-  mNativeCode[0] = mNativeSeverity[0] = mText[0] =
-   mQualifier[0] = 0;
 }
 
 char *Condition::toString(char *aBuffer, int aMaxLen)
@@ -526,43 +643,37 @@ char *Condition::toString(char *aBuffer, int aMaxLen)
   case eNORMAL: text = "NORMAL"; break;
   case eWARNING: text = "WARNING"; break;
   case eFAULT: text = "FAULT"; break;
-  default: ""; break;
+  default: text = ""; break;
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s|%s|%s|%s|", mName, text, mNativeCode, mNativeSeverity,
-          mQualifier);
-  appendText(aBuffer, mText, aMaxLen);
+  int length = snprintf(aBuffer, aMaxLen, "|%s|%s|%s|%s|%s|", mName.text(), text, mNativeCode.text(),
+                        mNativeSeverity.text(), mQualifier.text());
+  appendText(aBuffer, length, mText.text(), mText.length(), aMaxLen);
   return aBuffer;
 }
 
  bool Condition::setValue(ELevels aLevel, const char *aText, const char *aCode,
         const char *aQualifier, const char *aSeverity)
 {
+  beginWrite();
   if (!mHasValue ||
       mLevel != aLevel ||
-      strncmp(aCode, mNativeCode, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aQualifier, mQualifier, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aSeverity, mNativeSeverity, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aText, mText, EVENT_VALUE_LEN) != 0)
+      !mNativeCode.equals(aCode) ||
+      !mQualifier.equals(aQualifier) ||
+      !mNativeSeverity.equals(aSeverity) ||
+      !mText.equals(aText))
     
   {
     mLevel = aLevel;
+    mNativeCode.set(aCode);
+    mQualifier.set(aQualifier);
+    mNativeSeverity.set(aSeverity);
+    mText.set(aText);
     
-    strncpy(mNativeCode, aCode, EVENT_VALUE_LEN);
-    mNativeCode[EVENT_VALUE_LEN - 1] = '\0';
-    
-    strncpy(mQualifier, aQualifier, EVENT_VALUE_LEN);
-    mQualifier[EVENT_VALUE_LEN - 1] = '\0';
-
-    strncpy(mNativeSeverity, aSeverity, EVENT_VALUE_LEN);
-    mNativeSeverity[EVENT_VALUE_LEN - 1] = '\0';
-
-    strncpy(mText, aText, EVENT_VALUE_LEN);
-    mText[EVENT_VALUE_LEN - 1] = '\0';
-    
-    mChanged = true;
+    setChanged();
     mHasValue = true;
   }
-  
+  endWrite();
+
   return mChanged;
 }
 
@@ -581,33 +692,31 @@ bool Condition::unavailable()
 Message::Message(const char *aName) :
   DeviceDatum(aName)
 {
-  mNativeCode[0] = 0;
 }
 
 char *Message::toString(char *aBuffer, int aMaxLen)
 {
-  snprintf(aBuffer, aMaxLen, "|%s|%s|", mName, mNativeCode);
-  appendText(aBuffer, mText, aMaxLen);
+  int length = snprintf(aBuffer, aMaxLen, "|%s|%s|", mName.text(), mNativeCode.text());
+  appendText(aBuffer, length, mText.text(), mText.length(), aMaxLen);
   return aBuffer;
 }
 
  bool Message::setValue(const char *aText, const char *aCode)
 {
+  beginWrite();
   if (!mHasValue ||
-      strncmp(aCode, mNativeCode, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aText, mText, EVENT_VALUE_LEN) != 0)
+      !mNativeCode.equals(aCode) ||
+      !mText.equals(aText))
     
   {
-    strncpy(mNativeCode, aCode, EVENT_VALUE_LEN);
-    mNativeCode[EVENT_VALUE_LEN - 1] = '\0';
-    
-    strncpy(mText, aText, EVENT_VALUE_LEN);
-    mText[EVENT_VALUE_LEN - 1] = '\0';
+    mNativeCode.set(aCode);
+    mText.set(aText);
     
-    mChanged = true;
+    setChanged();
     mHasValue = true;
   }
-  
+  endWrite();
+
   return mChanged;
 }
 
@@ -622,51 +731,119 @@ bool Message::unavailable()
 }
 
 /*
- * PathPosition methods
+ * VectorSample methods
  */
-PathPosition::PathPosition(const char *aName)
+VectorSample::VectorSample(const char *aName)
   : DeviceDatum(aName)
 {
-  mX = mY = mZ = 0.0;
+  mDimension = 3;
+  for (int i = 0; i < MAX_VECTOR_DIMENSION; i++)
+  {
+    mValues[i] = 0.0;
+    mDeadbands[i] = 0.000001;
+  }
   mUnavailable = false;
 }
- 
-bool PathPosition::setValue(double aX, double aY, double aZ)
+
+/* To call before the first value is set */
+void VectorSample::setDimension(int aDimension)
 {
-  if (!mHasValue ||
-      fabs(aX - mX) > 0.000001 ||
-      fabs(aY - mY) > 0.000001 ||
-      fabs(aZ - mZ) > 0.000001 ||
-      mUnavailable)
+  if (aDimension < 1)
+    aDimension = 1;
+  else if (aDimension > MAX_VECTOR_DIMENSION)
+    aDimension = MAX_VECTOR_DIMENSION;
+  mDimension = aDimension;
+}
+
+void VectorSample::setDeadband(double aDeadband)
+{
+  for (int i = 0; i < MAX_VECTOR_DIMENSION; i++)
+    mDeadbands[i] = aDeadband;
+}
+
+void VectorSample::setDeadband(int aComponent, double aDeadband)
+{
+  if (aComponent >= 0 && aComponent < MAX_VECTOR_DIMENSION)
+    mDeadbands[aComponent] = aDeadband;
+}
+
+/* Set all the components at once, aValues has the dimension of the vector */
+bool VectorSample::setValue(const double *aValues)
+{
+  beginWrite();
+  bool changed = !mHasValue || mUnavailable;
+  for (int i = 0; !changed && i < mDimension; i++)
+    changed = fabs(aValues[i] - mValues[i]) > mDeadbands[i];
+  if (changed)
   {
-      mChanged = true;
-      mX = aX; mY = aY; mZ = aZ;
+      setChanged();
+      memcpy(mValues, aValues, mDimension * sizeof(double));
       mHasValue = true;
       mUnavailable = false;
   }
+  endWrite();
+
   return mChanged;
 }
 
-char *PathPosition::toString(char *aBuffer, int aMaxLen)
+char *VectorSample::toString(char *aBuffer, int aMaxLen)
 {
   if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
-  else
-    snprintf(aBuffer, aMaxLen, "|%s|%.10f %0.10f %0.10f", mName, mX, mY, mZ);
+  {
+    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName.text());
+    return aBuffer;
+  }
+
+  int length = snprintf(aBuffer, aMaxLen, "|%s|", mName.text());
+  for (int i = 0; i < mDimension && length >= 0 && length < aMaxLen; i++)
+    length += snprintf(aBuffer + length, aMaxLen - length, i == 0 ? "%.10f" : " %.10f",
+                       mValues[i]);
   return aBuffer;
 }
 
-bool PathPosition::unavailable()
+unsigned char VectorSample::binaryType()
+{
+  return BINARY_VECTOR;
+}
+
+void VectorSample::writeBinary(BinaryBuffer &aBuffer, unsigned int aId)
+{
+  aBuffer.putId(aId, mUnavailable);
+  if (!mUnavailable)
+  {
+    aBuffer.putVarint(mDimension);
+    for (int i = 0; i < mDimension; i++)
+      aBuffer.putDouble(mValues[i]);
+  }
+}
+
+bool VectorSample::unavailable()
 {
+  beginWrite();
   if (!mUnavailable)
   {
-    mChanged = true;
+    setChanged();
     mUnavailable = true;
   }
-  
+  endWrite();
+
   return mChanged;
 }
 
+/*
+ * PathPosition methods
+ */
+PathPosition::PathPosition(const char *aName)
+  : VectorSample(aName)
+{
+}
+ 
+bool PathPosition::setValue(double aX, double aY, double aZ)
+{
+  double values[3] = { aX, aY, aZ };
+  return VectorSample::setValue(values);
+}
+
 /*
  *  Availability methods
  */
@@ -681,30 +858,34 @@ Availability::Availability(const char *aName)
 char *Availability::toString(char *aBuffer, int aMaxLen)
 {
   if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
+    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName.text());
   else
-    snprintf(aBuffer, aMaxLen, "|%s|AVAILABLE", mName);
+    snprintf(aBuffer, aMaxLen, "|%s|AVAILABLE", mName.text());
   return aBuffer;
 }
 
 bool Availability::unavailable()
 {
+  beginWrite();
   if (!mUnavailable)
   {
-    mChanged = true;
+    setChanged();
     mUnavailable = true;
   }
-  
+  endWrite();
+
   return mChanged;
 }
 
 bool Availability::available()
 {
+  beginWrite();
   if (mUnavailable)
   {
-    mChanged = true;
+    setChanged();
     mUnavailable = false;
   }
-  
+  endWrite();
+
   return mChanged;
 }
@@ -37,6 +37,11 @@
 
 /* Forward class definitions */
 class StringBuffer;
+class BinaryBuffer;
+class SampleBank;
+
+/* Capacity of the data values of an adapter */
+const int MAX_DEVICE_DATA = 128;
 
 /* Some constants for field lengths */
 const int NAME_LEN = 32;
@@ -46,55 +51,179 @@ const int SEVERITY_LEN = 32;
 const int STATE_LEN = 32;
 const int DESCRIPTION_LEN = 512;
 const int EVENT_VALUE_LEN = 512;
+const int MAX_VECTOR_DIMENSION = 16;
+
+/* A text of a vocabulary, with its length computed at compile time */
+struct EnumText
+{
+  const char *mText;
+  int mLength;
+};
+
+#define ENUM_TEXT(text) { text, sizeof(text) - 1 }
+
+/*
+ * The SHDR fragment of a data value, |name|value, kept until the value
+ * changes. It belongs to the thread that sends the value: the copies of a
+ * data value, made by the thread that commits it, never read it and format
+ * their own fragment again.
+ */
+class Fragment
+{
+protected:
+  char *mText;
+  int mSize;
+
+public:
+  unsigned int mVersion; /* The version of the value it was formatted from */
+  bool mValid;
+
+  Fragment();
+  Fragment(const Fragment &aOther);
+  ~Fragment();
+  Fragment &operator=(const Fragment &aOther);
+
+  void set(const char *aText, unsigned int aVersion);
+  const char *text() { return mText; }
+};
+
+/*
+ * A text of a data value, with its length. A new text is compared in a
+ * single pass that stops at the first difference, and setting a text only
+ * copies its actual length.
+ */
+class TextField
+{
+protected:
+  char mText[EVENT_VALUE_LEN];
+  int mLength;
+
+public:
+  TextField();
+
+  bool equals(const char *aText) const;
+  void set(const char *aText);
+
+  const char *text() const { return mText; }
+  int length() const { return mLength; }
+};
+
+/*
+ * The name of a data value. The name of the item is kept in place; the
+ * name prefixed with a device, as "device:item", is only needed by the
+ * adapters that share a port and is allocated apart.
+ */
+class DatumName
+{
+protected:
+  char mItem[NAME_LEN];
+  char *mPrefixed; /* 0 without a device */
+  int mLength;
+
+public:
+  DatumName(const char *aItem);
+  DatumName(const DatumName &aOther);
+  ~DatumName();
+  DatumName &operator=(const DatumName &aOther);
+
+  void prefix(const char *aDevice);
+
+  const char *text() const { return (mPrefixed != 0) ? mPrefixed : mItem; }
+  int length() const { return mLength; }
+};
 
 /*
  * An abstract data value that knows its name and tracks when it has changed. 
  * 
  * The data value will be set in the subclasses.
+ *
+ * The value may be set from other threads than the one that sends it. The
+ * setters write the value between beginWrite and endWrite, which make the
+ * sequence odd then even again, and the readers (fragment, append and
+ * appendBinary) read it again if the sequence moved meanwhile. The setters
+ * never wait for the sender; concurrent setters of the same value wait for
+ * each other.
  */
 class DeviceDatum {
 protected:
   /* The name of the Data Value */
-  char mName[NAME_LEN];
+  DatumName mName;
   
   /* A changed flag to indicated that the value has changed since last append. */
-  bool mChanged;
+  volatile unsigned int mChanged;
+
+  /* Odd while a setter writes the value */
+  volatile unsigned int mSequence;
+
+  /* Incremented each time the value changes */
+  unsigned int mVersion;
+
+  /* The value formatted at its current version, if already needed */
+  Fragment mFragment;
   
   /* Has this data value been initialized? */
   bool mHasValue;
 
+  /* The cycle of the adapter the value was last sent in */
+  unsigned int mCycle;
+
 protected:
-  void appendText(char *aBuffer, char *aValue, unsigned int aMaxLen);
+  void appendText(char *aBuffer, int aLength, const char *aValue, int aValueLength, int aMaxLen);
+  char *formatText(char *aBuffer, int aMaxLen, const EnumText *aTexts, int aCount, int aIndex);
+  void beginWrite();
+  void endWrite();
+  void setChanged() { mChanged = true; mVersion++; }
+  virtual void writeBinary(BinaryBuffer &aBuffer, unsigned int aId);
 
 public:
   DeviceDatum(const char *aName);
   virtual ~DeviceDatum();
   
-  bool changed() { return mChanged; }
-  void reset() { mChanged = false; }
+  bool changed() { return mChanged != 0; }
+  void reset();
+  unsigned int cycle() { return mCycle; }
+  unsigned int version() { return mVersion; }
+  void setCycle(unsigned int aCycle) { mCycle = aCycle; }
   
-  char *getName() { return mName; }
+  const char *getName() { return mName.text(); }
+  void prefixName(const char *aDevice);
   virtual char *toString(char *aBuffer, int aMaxLen) = 0;
+  const char *fragment();
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) = 0;
+  DeviceDatum *commit(DeviceDatum *aTarget);
   virtual bool append(StringBuffer &aBuffer);
+  virtual unsigned char binaryType();
+  void appendBinary(BinaryBuffer &aBuffer, unsigned int aId);
   virtual bool hasInitialValue();
   virtual bool requiresFlush();
 
   virtual bool unavailable() = 0;
 };
 
+/* Copy a data value into aTarget, or into a new one if aTarget is 0 */
+template <class T> DeviceDatum *copyDatum(T *aSource, DeviceDatum *aTarget)
+{
+  if (aTarget == 0)
+    return new T(*aSource);
+  *static_cast<T *>(aTarget) = *aSource;
+  return aTarget;
+}
+
 /*
  * An event is a data value with a string value.
  */
 class Event : public DeviceDatum 
 {
 protected:
-  char mValue[EVENT_VALUE_LEN];
+  TextField mValue;
 
 public:
   Event(const char *aName);
   bool setValue(const char *aValue);
-  const char *getValue() { return mValue; }
+  const char *getValue() { return mValue.text(); }
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+  virtual void writeBinary(BinaryBuffer &aBuffer, unsigned int aId);
 
   virtual bool unavailable();
 };
@@ -114,6 +243,9 @@ public:
   bool setValue(int aValue);
   int getValue() { return mValue; }
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+  virtual unsigned char binaryType();
+  virtual void writeBinary(BinaryBuffer &aBuffer, unsigned int aId);
   
   virtual bool unavailable();
 };
@@ -127,44 +259,86 @@ class Sample : public DeviceDatum
 protected:
   double mValue;
   bool mUnavailable;
+  double mThreshold;   /* Smallest change that is reported */
+  SampleBank *mBank;   /* Once bound, the new values are staged in the bank */
+  int mSlot;
 
 public:
   Sample(const char *aName);
   bool setValue(double aValue);
   double getValue() { return mValue; }
+  bool isUnavailable() { return mUnavailable; }
+  void setThreshold(double aThreshold);
+  bool bind(SampleBank *aBank);
+  void detected(double aValue, unsigned char aState);
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget);
+  virtual unsigned char binaryType();
+  virtual void writeBinary(BinaryBuffer &aBuffer, unsigned int aId);
 
   virtual bool unavailable();
 };
 
+/*
+ * A data value from a closed vocabulary of MTConnect.
+ *
+ * The traits give the enumeration of the vocabulary, as EValues, whose first
+ * value is always eUNAVAILABLE, and the texts of its values in the order of
+ * the enumeration. A new vocabulary is then just a traits structure and its
+ * table of texts.
+ */
+template <class Traits> class EnumDatum : public DeviceDatum, public Traits
+{
+public:
+  typedef typename Traits::EValues EValues;
+
+protected:
+  EValues mValue;
+
+public:
+  EnumDatum(const char *aName) : DeviceDatum(aName) { mValue = (EValues) 0; }
+  bool setValue(EValues aValue)
+  {
+    beginWrite();
+    if (mValue != aValue || !mHasValue)
+    {
+      mValue = aValue;
+      setChanged();
+      mHasValue = true;
+    }
+    endWrite();
+
+    return mChanged != 0;
+  }
+  EValues getValue() { return mValue; }
+  virtual char *toString(char *aBuffer, int aMaxLen)
+  {
+    return formatText(aBuffer, aMaxLen, Traits::sTexts, Traits::sCount, (int) mValue);
+  }
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+
+  virtual bool unavailable() { return setValue((EValues) 0); }
+};
+
 /* Power status data value */
 
-class PowerState : public DeviceDatum 
+struct PowerStateValues
 {
-public:
   enum EPowerState {
     eUNAVAILABLE,
     eON,
     eOFF,
   };
-  
-protected:
-  EPowerState mState;
-  
-public:
-  PowerState(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EPowerState aState);
-  EPowerState getValue() { return mState; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-  
-  virtual bool unavailable();
+  typedef EPowerState EValues;
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<PowerStateValues> PowerState;
 
 /* Executaion state */
 
-class Execution : public DeviceDatum 
+struct ExecutionValues
 {
-public:
   enum EExecutionState {
     eUNAVAILABLE,
     eREADY,
@@ -173,24 +347,16 @@ public:
     eACTIVE,
     eFEED_HOLD
   };
-  
-protected:
-  EExecutionState mState;
-  
-public:
-  Execution(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EExecutionState aState);
-  EExecutionState getValue() { return mState; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-  
-  virtual bool unavailable();
+  typedef EExecutionState EValues;
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<ExecutionValues> Execution;
 
 /* ControllerMode  */
 
-class ControllerMode : public DeviceDatum
+struct ControllerModeValues
 {
-public:
   enum EMode {
     eUNAVAILABLE,
     eAUTOMATIC,
@@ -198,72 +364,45 @@ public:
     eMANUAL_DATA_INPUT,
     eSEMI_AUTOMATIC
   };
-  
-protected:
-  EMode mMode;
-  
-public:
-  ControllerMode(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EMode aState);
-  EMode getValue() { return mMode; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  typedef EMode EValues;
+  static const EnumText sTexts[];
+  static const int sCount;
 };
-
+typedef EnumDatum<ControllerModeValues> ControllerMode;
 
 /* Direction  */
 
-class Direction : public DeviceDatum
+struct DirectionValues
 {
-public:
   enum ERotationDirection {
     eUNAVAILABLE,
     eCLOCKWISE,
     eCOUNTER_CLOCKWISE
   };
-  
-protected:
-  ERotationDirection mDirection;
-  
-public:
-  Direction(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum ERotationDirection aDirection);
-  ERotationDirection getValue() { return mDirection; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  typedef ERotationDirection EValues;
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<DirectionValues> Direction;
 
 // Version 1.1
 
 /* Emergency Stop */
 
-class EmergencyStop : public DeviceDatum
+struct EmergencyStopValues
 {
-public:
   enum EValues {
     eUNAVAILABLE,
     eTRIGGERED,
     eARMED
   };
-  
-protected:
-  EValues mValue;
-  
-public:
-  EmergencyStop(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EValues aValue);
-  EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<EmergencyStopValues> EmergencyStop;
 
-
-class AxisCoupling : public DeviceDatum
+struct AxisCouplingValues
 {
-public:
   enum EValues {
     eUNAVAILABLE,
     eTANDEM,
@@ -271,83 +410,48 @@ public:
     eMASTER,
     eSLAVE
   };
-  
-protected:
-  EValues mValue;
-  
-public:
-  AxisCoupling(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EValues aValue);
-  EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<AxisCouplingValues> AxisCoupling;
 
-class DoorState : public DeviceDatum
+struct DoorStateValues
 {
-public:
   enum EValues {
     eUNAVAILABLE,
     eOPEN,
     eCLOSED
   };
-  
-protected:
-  EValues mValue;
-  
-public:
-  DoorState(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EValues aValue);
-  EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<DoorStateValues> DoorState;
 
-class PathMode : public DeviceDatum
+struct PathModeValues
 {
-public:
   enum EValues {
     eUNAVAILABLE,
     eINDEPENDENT,
     eSYNCHRONOUS,
     eMIRROR
   };
-  
-protected:
-  EValues mValue;
-  
-public:
-  PathMode(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EValues aValue);
-  EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<PathModeValues> PathMode;
 
-class RotaryMode : public DeviceDatum
+struct RotaryModeValues
 {
-public:
   enum EValues {
     eUNAVAILABLE,
     eSPINDLE,
     eINDEX,
     eCONTOUR
   };
-  
-protected:
-  EValues mValue;
-  
-public:
-  RotaryMode(const char *aName) : DeviceDatum(aName) { }
-  bool setValue(enum EValues aValue);
-  EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
-
-  virtual bool unavailable();
+  static const EnumText sTexts[];
+  static const int sCount;
 };
+typedef EnumDatum<RotaryModeValues> RotaryMode;
 
 // The conditon items
 
@@ -363,57 +467,82 @@ public:
 
 protected:
   ELevels mLevel;
-  char mText[EVENT_VALUE_LEN];
-  char mNativeCode[EVENT_VALUE_LEN];
-  char mNativeSeverity[EVENT_VALUE_LEN];
-  char mQualifier[EVENT_VALUE_LEN];
+  TextField mText;
+  TextField mNativeCode;
+  TextField mNativeSeverity;
+  TextField mQualifier;
 
 public:
   Condition(const char *aName);
   bool setValue(ELevels aLevel, const char *aText = "", const char *aCode = "",
     const char *aQualifier = "", const char *aSeverity = ""); 
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
 
   ELevels getLevel() { return mLevel; }
-  const char *getText() { return mText; }
-  const char *getNativeCode() { return mNativeCode; }
-  const char *getNativeSeverity() { return mNativeSeverity; }
-  const char *getQualifier() { return mQualifier; }
+  const char *getText() { return mText.text(); }
+  const char *getNativeCode() { return mNativeCode.text(); }
+  const char *getNativeSeverity() { return mNativeSeverity.text(); }
+  const char *getQualifier() { return mQualifier.text(); }
 
   virtual bool requiresFlush();
   virtual bool unavailable();
 };
 
 class Message : public DeviceDatum {
-  char mText[EVENT_VALUE_LEN];
-  char mNativeCode[EVENT_VALUE_LEN];
+  TextField mText;
+  TextField mNativeCode;
 
 public:
   Message(const char *aName);
   bool setValue(const char *aText, const char *aCode = ""); 
   virtual char *toString(char *aBuffer, int aMaxLen);
-  const char *getNativeCode() { return mNativeCode; }
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+  const char *getNativeCode() { return mNativeCode.text(); }
   
   virtual bool requiresFlush();  
   virtual bool unavailable();
 };
   
-class PathPosition : public DeviceDatum {
+/*
+ * A vector sample: the values of several components, sent together in a
+ * single field as "|name|x y z ...", so that they stay coherent in time. A
+ * change of a component smaller than its deadband is ignored.
+ */
+class VectorSample : public DeviceDatum {
 protected:
-  double mX, mY, mZ;
+  double mValues[MAX_VECTOR_DIMENSION];
+  double mDeadbands[MAX_VECTOR_DIMENSION];
+  int mDimension;
   bool mUnavailable;
 
 public:
-  PathPosition(const char *aName);
-  bool setValue(double aX, double aY, double aZ);
-  double getX() { return mX; }
-  double getY() { return mY; }
-  double getZ() { return mZ; }
+  VectorSample(const char *aName);
+  void setDimension(int aDimension);
+  int getDimension() { return mDimension; }
+  void setDeadband(double aDeadband);
+  void setDeadband(int aComponent, double aDeadband);
+  bool setValue(const double *aValues);
+  double getValue(int aComponent) { return mValues[aComponent]; }
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+  virtual unsigned char binaryType();
+  virtual void writeBinary(BinaryBuffer &aBuffer, unsigned int aId);
 
   virtual bool unavailable();  
 };
 
+class PathPosition : public VectorSample {
+public:
+  PathPosition(const char *aName);
+  using VectorSample::setValue;
+  bool setValue(double aX, double aY, double aZ);
+  double getX() { return mValues[0]; }
+  double getY() { return mValues[1]; }
+  double getZ() { return mValues[2]; }
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
+};
+
 class Availability : public DeviceDatum 
 {
 protected:
@@ -422,6 +551,7 @@ protected:
 public:
   Availability(const char *aName);
   virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual DeviceDatum *copy(DeviceDatum *aTarget) { return copyDatum(this, aTarget); }
   bool available();
   virtual bool unavailable();  
 };
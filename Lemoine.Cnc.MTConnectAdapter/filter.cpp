@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "filter.hpp"
+
+/* aSpec must be normalized */
+Filter::Filter(const char *aSpec)
+{
+  mRefCount = 0;
+  mNumPatterns = 0;
+  strncpy(mSpec, aSpec, FILTER_SPEC_LEN);
+  mSpec[FILTER_SPEC_LEN - 1] = '\0';
+
+  /* The patterns point into the spec, with their own length */
+  char *cp = mSpec;
+  while (*cp != '\0' && mNumPatterns < MAX_FILTER_PATTERNS)
+  {
+    char *end = strchr(cp, ' ');
+    size_t len = (end != 0) ? (size_t) (end - cp) : strlen(cp);
+    mPrefix[mNumPatterns] = (cp[len - 1] == '*');
+    mLengths[mNumPatterns] = mPrefix[mNumPatterns] ? len - 1 : len;
+    mPatterns[mNumPatterns++] = cp;
+    if (end == 0)
+      break;
+    cp = end + 1;
+  }
+}
+
+/* Separate the patterns with a single space, whatever the separators in the
+ * command were (spaces or commas), so that equal lists share a filter */
+void Filter::normalize(const char *aSpec, char *aResult, size_t aMaxLen)
+{
+  size_t len = 0;
+  const char *cp = aSpec;
+  while (*cp != '\0')
+  {
+    while (*cp == ' ' || *cp == ',')
+      cp++;
+    if (*cp == '\0')
+      break;
+    if (len > 0 && len < aMaxLen - 1)
+      aResult[len++] = ' ';
+    while (*cp != '\0' && *cp != ' ' && *cp != ',')
+    {
+      if (len < aMaxLen - 1)
+        aResult[len++] = *cp;
+      cp++;
+    }
+  }
+  aResult[len] = '\0';
+}
+
+bool Filter::matches(const char *aName)
+{
+  for (int i = 0; i < mNumPatterns; i++)
+  {
+    if (mPrefix[i])
+    {
+      if (strncmp(aName, mPatterns[i], mLengths[i]) == 0)
+        return true;
+    }
+    else if (strncmp(aName, mPatterns[i], mLengths[i]) == 0 &&
+             aName[mLengths[i]] == '\0')
+      return true;
+  }
+  return false;
+}
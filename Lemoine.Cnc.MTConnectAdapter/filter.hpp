@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include "string_buffer.hpp"
+
+const int MAX_FILTER_PATTERNS = 64;
+const int FILTER_SPEC_LEN = 1024;
+
+/*
+ * A subscription of the clients: a list of data item names, or of prefixes
+ * when the name ends with '*', as "* subscribe Xact Yact path_*".
+ *
+ * The clients that subscribe to the same list share the same filter, so that
+ * the adapters build the frame of a filter only once per cycle.
+ */
+class Filter
+{
+protected:
+  char mSpec[FILTER_SPEC_LEN];   /* The patterns, separated by a single space */
+  const char *mPatterns[MAX_FILTER_PATTERNS];
+  size_t mLengths[MAX_FILTER_PATTERNS];
+  bool mPrefix[MAX_FILTER_PATTERNS];
+  int mNumPatterns;
+
+public:
+  int mRefCount;          /* Number of clients using the filter */
+  StringBuffer mBuffer;   /* The frame of the cycle for the clients of the filter */
+
+public:
+  Filter(const char *aSpec);
+
+  static void normalize(const char *aSpec, char *aResult, size_t aMaxLen);
+  const char *spec() { return mSpec; }
+  bool matches(const char *aName);
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "device_datum.hpp"
+#include "generations.hpp"
+#include "atomic.hpp"
+
+Generations::Generations()
+{
+  memset(mData, 0, sizeof(mData));
+  memset(mSent, 0, sizeof(mSent));
+  mFront = 0;
+  mLock = 0;
+  mPending = 0;
+}
+
+Generations::~Generations()
+{
+  for (int g = 0; g < 2; g++)
+  {
+    for (int i = 0; i < MAX_DEVICE_DATA; i++)
+    {
+      if (mData[g][i] != 0)
+        delete mData[g][i];
+    }
+  }
+  for (int i = 0; i < MAX_DEVICE_DATA; i++)
+  {
+    if (mSent[i] != 0)
+      delete mSent[i];
+  }
+}
+
+void Generations::beginCommit()
+{
+  while (!atomicCompareExchange32((volatile uint32_t *) &mLock, 0, 1))
+    ;
+}
+
+/* Copy a value that changed into the back generation */
+void Generations::commit(DeviceDatum *aValue, int aIndex)
+{
+  int back = 1 - mFront;
+  mData[back][aIndex] = aValue->commit(mData[back][aIndex]);
+  mPending = 1;
+}
+
+void Generations::endCommit()
+{
+  atomicStore32((volatile uint32_t *) &mLock, 0);
+}
+
+/* Make the last committed generation the front one. Returns false if nothing
+ * was committed since the previous swap. */
+bool Generations::swap()
+{
+  beginCommit();
+  bool pending = (mPending != 0);
+  if (pending)
+  {
+    mFront = 1 - mFront;
+    mPending = 0;
+  }
+  endCommit();
+  return pending;
+}
+
+/* Keep the value of the front generation that was just sent. The front
+ * generation is not committed to until the next swap, by the sender too. */
+void Generations::sent(int aIndex)
+{
+  mSent[aIndex] = mData[mFront][aIndex]->copy(mSent[aIndex]);
+}
@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef GENERATIONS_HPP
+#define GENERATIONS_HPP
+
+class DeviceDatum;
+
+/*
+ * The two committed generations of the data values of an adapter, for the
+ * producers that use beginCycle and commitCycle.
+ *
+ * A commit copies the values that changed into the back generation, where
+ * they accumulate until the sender takes it: swap makes it the front one,
+ * which the sender serializes while the next commits go to the other one.
+ * The lock only covers the copies of a commit and the swap itself.
+ *
+ * The values sent from the front generation are also copied as the last
+ * sent ones, that only the sender uses, for the new clients and the clients
+ * with an update rate: they never see a value that was not committed.
+ */
+class Generations
+{
+protected:
+  DeviceDatum *mData[2][MAX_DEVICE_DATA]; /* Copies of the values, created on their first commit */
+  DeviceDatum *mSent[MAX_DEVICE_DATA]; /* The values last sent */
+  int mFront;                    /* The generation the sender reads */
+  volatile unsigned int mLock;
+  volatile unsigned int mPending; /* Was anything committed since the last swap ? */
+
+public:
+  Generations();
+  ~Generations();
+
+  void beginCommit();
+  void commit(DeviceDatum *aValue, int aIndex);
+  void endCommit();
+
+  bool swap();
+  DeviceDatum *front(int aIndex) { return mData[mFront][aIndex]; }
+  void sent(int aIndex);
+  DeviceDatum *latest(int aIndex) { return mSent[aIndex]; }
+};
+
+#endif
@@ -36,7 +36,11 @@
 #define _CRT_SECURE_NO_DEPRECATE 1
 
 /* Windows specific include files and types */
+/* The shared server host selects on the sockets of many servers */
+#define FD_SETSIZE 1024
 #include "winsock2.h"
+#include "ws2tcpip.h"
+#include "afunix.h"
 #include "windows.h"
 #include "errno.h"
 
@@ -54,6 +58,8 @@ typedef int socklen_t;
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
 typedef unsigned int uint32_t;
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
 
 #define UINT16_MAX 0xFFFF
 
@@ -68,6 +74,8 @@ typedef unsigned int uint32_t;
 #include <sys/time.h>
 #include <time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -75,9 +83,11 @@ typedef unsigned int uint32_t;
 #include <termios.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 
 typedef struct sockaddr_in SOCKADDR_IN;
 typedef struct sockaddr SOCKADDR;
+typedef struct sockaddr_un SOCKADDR_UN;
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
 #define SOCKET int
@@ -0,0 +1,443 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "metrics_server.hpp"
+#include "logger.hpp"
+
+struct MetricFamily
+{
+  const char *mName;
+  const char *mType;
+  const char *mHelp;
+};
+
+static const MetricFamily sFamilies[eNUM_METRICS] = {
+  { "mtconnect_adapter_clients", "gauge",
+    "Connected clients" },
+  { "mtconnect_adapter_client_pending_bytes", "gauge",
+    "Output pending for a client" },
+  { "mtconnect_adapter_client_pending_high_water_bytes", "gauge",
+    "Most output that was pending for a client at once" },
+  { "mtconnect_adapter_client_sent_bytes_total", "counter",
+    "Bytes sent to a client, compressed if so" },
+  { "mtconnect_adapter_client_heartbeat_interval_seconds", "gauge",
+    "Time between the last two heartbeats of a client" },
+  { "mtconnect_adapter_client_heartbeat_age_seconds", "gauge",
+    "Time since the last heartbeat of a client" },
+  { "mtconnect_adapter_disconnects_total", "counter",
+    "Clients disconnected, by reason" },
+  { "mtconnect_adapter_write_seconds", "summary",
+    "Duration of a write to a client" },
+  { "mtconnect_adapter_writes_total", "counter",
+    "Writes to the clients" },
+  { "mtconnect_adapter_written_bytes_total", "counter",
+    "Bytes written to the clients, before compression" },
+  { "mtconnect_adapter_duration_seconds", "summary",
+    "Duration of Start, of the sending of the changed data and of the initial data" },
+  { "mtconnect_adapter_changed_items", "summary",
+    "Values sent per cycle" },
+  { "mtconnect_adapter_frame_bytes", "summary",
+    "Size of the frame of a cycle" },
+  { "mtconnect_adapter_frame_high_water_bytes", "gauge",
+    "Largest frame of a cycle" },
+  { "mtconnect_adapter_cycles_total", "counter",
+    "Cycles sent" }
+};
+
+static const char *sReasons[eNUM_DISCONNECT_REASONS] = {
+  "closed", "read_error", "write_error", "heartbeat", "rejected"
+};
+
+static const char *sPaths[] = { "start", "changed", "initial" };
+
+MetricsServer MetricsServer::sInstance;
+
+MetricsServer::MetricsServer()
+{
+  mNumServers = 0;
+  mSocket = INVALID_SOCKET;
+  mPort = 0;
+  mStarted = false;
+}
+
+/* Copy a label value, escaped */
+static void escapeLabel(char *aTarget, int aSize, const char *aValue)
+{
+  int length = 0;
+  for (const char *cp = aValue; *cp != '\0' && length < aSize - 2; cp++)
+  {
+    if (*cp == '\\' || *cp == '"' || *cp == '\n')
+    {
+      aTarget[length++] = '\\';
+      aTarget[length++] = (*cp == '\n') ? 'n' : *cp;
+    }
+    else
+      aTarget[length++] = *cp;
+  }
+  aTarget[length] = '\0';
+}
+
+/* Listen on the port and start the thread, the first time only. The other
+ * adapters share this listener, whatever port they ask for. */
+bool MetricsServer::start(int aPort, bool aLoopback)
+{
+  MutexLock lock(mMutex);
+
+  if (mStarted)
+  {
+    if (aPort != mPort)
+      gLogger->warning("The metrics are already served on port %d, not on %d", mPort, aPort);
+    return true;
+  }
+
+  SOCKET sock = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock == INVALID_SOCKET)
+  {
+    gLogger->error("Error at socket() for the metrics.");
+    return false;
+  }
+
+#ifndef WIN32
+  /* The connections are closed by this side: allow a restart while they
+   * are in TIME_WAIT */
+  int reuse = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *) &reuse, sizeof(reuse));
+#endif
+
+  SOCKADDR_IN t;
+  memset(&t, 0, sizeof(t));
+  t.sin_family = AF_INET;
+  t.sin_port = htons(aPort);
+  t.sin_addr.s_addr = htonl(aLoopback ? INADDR_LOOPBACK : INADDR_ANY);
+  if (::bind(sock, (SOCKADDR *)&t, sizeof(t)) == SOCKET_ERROR ||
+      listen(sock, 4) == SOCKET_ERROR)
+  {
+    gLogger->error("Failed to listen on port %d for the metrics", aPort);
+    ::closesocket(sock);
+    return false;
+  }
+
+  mSocket = sock;
+  mPort = aPort;
+#ifdef WIN32
+  mThread = CreateThread(0, 0, threadMain, this, 0, 0);
+  mStarted = (mThread != 0);
+#else
+  mStarted = (pthread_create(&mThread, 0, threadMain, this) == 0);
+#endif
+  if (!mStarted)
+  {
+    gLogger->error("Could not start the thread of the metrics");
+    ::closesocket(mSocket);
+    mSocket = INVALID_SOCKET;
+    return false;
+  }
+
+  gLogger->info("Metrics served on %s port %d", aLoopback ? "loopback" : "all interfaces", aPort);
+  return true;
+}
+
+void MetricsServer::attach(Server *aServer)
+{
+  MutexLock lock(mMutex);
+
+  for (int i = 0; i < mNumServers; i++)
+  {
+    if (mServers[i] == aServer)
+    {
+      mReferences[i]++;
+      return;
+    }
+  }
+
+  if (mNumServers == MAX_METRICS_SERVERS)
+  {
+    gLogger->warning("Too many servers, the metrics of port %d are not served", aServer->port());
+    return;
+  }
+  mServers[mNumServers] = aServer;
+  mReferences[mNumServers] = 1;
+  mNumServers++;
+}
+
+/* Forget a server, before it is deleted. The metrics are not read while
+ * the list of servers is locked. */
+void MetricsServer::detach(Server *aServer)
+{
+  MutexLock lock(mMutex);
+
+  for (int i = 0; i < mNumServers; i++)
+  {
+    if (mServers[i] == aServer)
+    {
+      if (--mReferences[i] == 0)
+      {
+        mNumServers--;
+        mServers[i] = mServers[mNumServers];
+        mReferences[i] = mReferences[mNumServers];
+      }
+      return;
+    }
+  }
+}
+
+#ifdef WIN32
+DWORD WINAPI MetricsServer::threadMain(LPVOID aMetrics)
+{
+  ((MetricsServer *) aMetrics)->run();
+  return 0;
+}
+#else
+void *MetricsServer::threadMain(void *aMetrics)
+{
+  ((MetricsServer *) aMetrics)->run();
+  return 0;
+}
+#endif
+
+/* Answer the requests one at a time, for the life of the process */
+void MetricsServer::run()
+{
+  for (;;)
+  {
+    SOCKET socket = ::accept(mSocket, 0, 0);
+    if (socket == INVALID_SOCKET)
+    {
+      usleep(METRICS_TIMEOUT * 1000);
+      continue;
+    }
+
+    /* A client that does not read or write must not block the others */
+#ifdef WIN32
+    DWORD timeout = METRICS_TIMEOUT;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = METRICS_TIMEOUT / 1000;
+    timeout.tv_usec = (METRICS_TIMEOUT % 1000) * 1000;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *) &timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *) &timeout, sizeof(timeout));
+
+    answer(socket);
+    ::closesocket(socket);
+  }
+}
+
+/* Read the request up to the end of its headers, or up to the end of its
+ * first line without HTTP version, then send the metrics */
+void MetricsServer::answer(SOCKET aSocket)
+{
+  char request[METRICS_REQUEST_LEN];
+  int length = 0;
+  bool http = false;
+  for (;;)
+  {
+    int received = ::recv(aSocket, request + length, METRICS_REQUEST_LEN - 1 - length, 0);
+    if (received <= 0)
+      return;
+    length += received;
+    request[length] = '\0';
+
+    char *eol = strchr(request, '\n');
+    if (eol == 0)
+    {
+      if (length == METRICS_REQUEST_LEN - 1)
+        return;
+      continue;
+    }
+    *eol = '\0';
+    http = (strstr(request, " HTTP/") != 0);
+    *eol = '\n';
+    if (!http || strstr(request, "\r\n\r\n") != 0 || strstr(request, "\n\n") != 0)
+      break;
+    if (length == METRICS_REQUEST_LEN - 1)
+      return;
+  }
+
+  char header[160];
+  const char *body;
+  int bodyLength;
+  if (http && strncmp(request, "GET ", 4) != 0)
+  {
+    body = "Method not allowed\n";
+    bodyLength = (int) strlen(body);
+    sprintf(header, "HTTP/1.0 405 Method Not Allowed\r\n"
+      "Content-Type: text/plain\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+      bodyLength);
+  }
+  else
+  {
+    MutexLock lock(mMutex);
+    collect();
+    body = mBody;
+    bodyLength = (int) mBody.length();
+    sprintf(header, "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+      bodyLength);
+  }
+
+  /* The body stays valid: the requests are answered by this thread only */
+  const char *parts[2] = { http ? header : "", body };
+  int lengths[2] = { http ? (int) strlen(header) : 0, bodyLength };
+  for (int i = 0; i < 2; i++)
+  {
+    int sent = 0;
+    while (sent < lengths[i])
+    {
+      int n = ::send(aSocket, parts[i] + sent, lengths[i] - sent, 0);
+      if (n <= 0)
+        return;
+      sent += n;
+    }
+  }
+}
+
+/* Write the metrics of all the servers in mBody, family by family */
+void MetricsServer::collect()
+{
+  for (int i = 0; i < eNUM_METRICS; i++)
+    mFamilies[i].reset();
+
+  for (int i = 0; i < mNumServers; i++)
+  {
+    Server *server = mServers[i];
+    server->lock();
+    collect(server);
+    server->unlock();
+  }
+
+  mBody.reset();
+  for (int i = 0; i < eNUM_METRICS; i++)
+  {
+    char line[256];
+    sprintf(line, "# HELP %s %s\n# TYPE %s %s\n", sFamilies[i].mName, sFamilies[i].mHelp,
+      sFamilies[i].mName, sFamilies[i].mType);
+    mBody.append(line);
+    if (mFamilies[i].length() > 0)
+      mBody.append(mFamilies[i]);
+  }
+}
+
+/* The metrics of a server and of its sources, with the server locked */
+void MetricsServer::collect(Server *aServer)
+{
+  char server[LOCAL_PATH_LEN * 2 + 16];
+  if (aServer->mPort > 0)
+    sprintf(server, "server=\"%d\"", aServer->mPort);
+  else
+  {
+    char path[LOCAL_PATH_LEN * 2];
+    escapeLabel(path, sizeof(path), aServer->mLocalPath);
+    sprintf(server, "server=\"%s\"", path);
+  }
+
+  char labels[512];
+  sample(eMETRIC_CLIENTS, "", server, aServer->mNumClients);
+
+  unsigned int now = aServer->getTimestamp();
+  for (int i = 0; i < aServer->mNumClients; i++)
+  {
+    Client *client = aServer->mClients[i];
+    sprintf(labels, "%s,client=\"%s\"", server, client->mPeer);
+    sample(eMETRIC_CLIENT_PENDING, "", labels, client->pending());
+    sample(eMETRIC_CLIENT_PENDING_HIGH_WATER, "", labels, client->mPendingHighWater);
+    sample(eMETRIC_CLIENT_SENT, "", labels, (double) client->mBytesSent);
+    if (client->mHeartbeats)
+    {
+      if (client->mHeartbeatInterval > 0)
+        sample(eMETRIC_CLIENT_HEARTBEAT_INTERVAL, "", labels, client->mHeartbeatInterval / 1000.0);
+      sample(eMETRIC_CLIENT_HEARTBEAT_AGE, "", labels,
+        aServer->deltaTimestamp(now, client->mLastHeartbeat) / 1000.0);
+    }
+  }
+
+  for (int i = 0; i < eNUM_DISCONNECT_REASONS; i++)
+  {
+    sprintf(labels, "%s,reason=\"%s\"", server, sReasons[i]);
+    sample(eMETRIC_DISCONNECTS, "", labels, aServer->mDisconnects[i]);
+  }
+
+  Stats &stats = aServer->mStats;
+  summary(eMETRIC_WRITE_DURATION, server, stats.mLatency[Stats::eSEND], 1e-6);
+  sample(eMETRIC_WRITES, "", server, (double) stats.mItems);
+  sample(eMETRIC_WRITTEN, "", server, (double) stats.mBytes);
+
+  for (int i = 0; i < MAX_SOURCES; i++)
+  {
+    Stats *source = aServer->mSourceStats[i];
+    if (source == 0)
+      continue;
+
+    char device[STATS_NAME_LEN * 2];
+    escapeLabel(device, sizeof(device), source->mName);
+    int length = sprintf(labels, "%s,source=\"%d\",device=\"%s\"", server, i, device);
+    for (int j = Stats::eSTART; j <= Stats::eINITIAL; j++)
+    {
+      sprintf(labels + length, ",path=\"%s\"", sPaths[j]);
+      summary(eMETRIC_DURATION, labels, source->mLatency[j], 1e-6);
+    }
+    labels[length] = '\0';
+    summary(eMETRIC_CHANGED_ITEMS, labels, source->mItemsPerCycle, 1.0);
+    summary(eMETRIC_FRAME_BYTES, labels, source->mBytesPerCycle, 1.0);
+    sample(eMETRIC_FRAME_HIGH_WATER, "", labels, source->mBytesPerCycle.max());
+    sample(eMETRIC_CYCLES, "", labels, (double) source->mCycles);
+  }
+}
+
+void MetricsServer::sample(EMetric aMetric, const char *aSuffix, const char *aLabels, double aValue)
+{
+  char line[768];
+  snprintf(line, sizeof(line), "%s%s{%s} %.15g\n", sFamilies[aMetric].mName, aSuffix,
+    aLabels, aValue);
+  mFamilies[aMetric].append(line);
+}
+
+/* The quantiles, the sum and the count of a histogram, in the unit of the
+ * metric with aScale */
+void MetricsServer::summary(EMetric aMetric, const char *aLabels, Histogram &aHistogram,
+                            double aScale)
+{
+  static const double quantiles[] = { 50.0, 90.0, 99.0, 99.9 };
+  static const char *names[] = { "0.5", "0.9", "0.99", "0.999" };
+
+  char labels[600];
+  for (int i = 0; i < 4; i++)
+  {
+    snprintf(labels, sizeof(labels), "%s,quantile=\"%s\"", aLabels, names[i]);
+    sample(aMetric, "", labels, aHistogram.percentile(quantiles[i]) * aScale);
+  }
+  sample(aMetric, "_sum", aLabels, aHistogram.sum() * aScale);
+  sample(aMetric, "_count", aLabels, aHistogram.count());
+}
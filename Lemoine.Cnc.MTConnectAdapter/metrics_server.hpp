@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include "server.hpp"
+#include "string_buffer.hpp"
+
+const int MAX_METRICS_SERVERS = 256;
+const int METRICS_REQUEST_LEN = 4096;
+const int METRICS_TIMEOUT = 1000; /* ms */
+
+/* The metric families, each one is written at once for all the servers */
+enum EMetric {
+  eMETRIC_CLIENTS,
+  eMETRIC_CLIENT_PENDING,
+  eMETRIC_CLIENT_PENDING_HIGH_WATER,
+  eMETRIC_CLIENT_SENT,
+  eMETRIC_CLIENT_HEARTBEAT_INTERVAL,
+  eMETRIC_CLIENT_HEARTBEAT_AGE,
+  eMETRIC_DISCONNECTS,
+  eMETRIC_WRITE_DURATION,
+  eMETRIC_WRITES,
+  eMETRIC_WRITTEN,
+  eMETRIC_DURATION,
+  eMETRIC_CHANGED_ITEMS,
+  eMETRIC_FRAME_BYTES,
+  eMETRIC_FRAME_HIGH_WATER,
+  eMETRIC_CYCLES,
+  eNUM_METRICS
+};
+
+/*
+ * Exposes the statistics of the servers and of their sources in the text
+ * format of Prometheus, on a listener of its own, on the loopback interface
+ * by default. Any GET request is answered with the metrics. A line without
+ * HTTP version, "metrics" from a terminal for example, gets them in plain text.
+ *
+ * The listener has its own thread. The servers are locked one at a time
+ * while their metrics are read. There is one listener per process, shared
+ * by all the adapters, like the ServerHost.
+ */
+class MetricsServer
+{
+protected:
+  static MetricsServer sInstance;
+
+  Mutex mMutex;            /* Protects the list of servers */
+  Server *mServers[MAX_METRICS_SERVERS];
+  int mReferences[MAX_METRICS_SERVERS];
+  int mNumServers;
+  SOCKET mSocket;
+  int mPort;
+  bool mStarted;
+  StringBuffer mFamilies[eNUM_METRICS]; /* The samples of each family */
+  StringBuffer mBody;
+#ifdef WIN32
+  HANDLE mThread;
+  static DWORD WINAPI threadMain(LPVOID aMetrics);
+#else
+  pthread_t mThread;
+  static void *threadMain(void *aMetrics);
+#endif
+
+  MetricsServer();
+  void run();
+  void answer(SOCKET aSocket);
+  void collect();
+  void collect(Server *aServer);
+  void sample(EMetric aMetric, const char *aSuffix, const char *aLabels, double aValue);
+  void summary(EMetric aMetric, const char *aLabels, Histogram &aHistogram, double aScale);
+
+public:
+  static MetricsServer *instance() { return &sInstance; }
+
+  bool start(int aPort, bool aLoopback);
+  void attach(Server *aServer);
+  void detach(Server *aServer);
+};
+
+#endif
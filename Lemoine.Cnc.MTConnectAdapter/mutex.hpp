@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef MUTEX_HPP
+#define MUTEX_HPP
+
+/*
+ * A recursive mutex, on top of a critical section on Windows and a pthread
+ * mutex elsewhere.
+ */
+class Mutex
+{
+protected:
+#ifdef WIN32
+  CRITICAL_SECTION mSection;
+#else
+  pthread_mutex_t mMutex;
+#endif
+
+public:
+#ifdef WIN32
+  Mutex() { InitializeCriticalSection(&mSection); }
+  ~Mutex() { DeleteCriticalSection(&mSection); }
+  void lock() { EnterCriticalSection(&mSection); }
+  bool tryLock() { return TryEnterCriticalSection(&mSection) != 0; }
+  void unlock() { LeaveCriticalSection(&mSection); }
+#else
+  Mutex()
+  {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mMutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+  }
+  ~Mutex() { pthread_mutex_destroy(&mMutex); }
+  void lock() { pthread_mutex_lock(&mMutex); }
+  bool tryLock() { return pthread_mutex_trylock(&mMutex) == 0; }
+  void unlock() { pthread_mutex_unlock(&mMutex); }
+#endif
+};
+
+/* Lock a mutex for the duration of a scope */
+class MutexLock
+{
+protected:
+  Mutex &mMutex;
+
+public:
+  MutexLock(Mutex &aMutex) : mMutex(aMutex) { mMutex.lock(); }
+  ~MutexLock() { mMutex.unlock(); }
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "replay_buffer.hpp"
+
+ReplayBuffer::ReplayBuffer(int aCapacity)
+{
+  mCapacity = aCapacity;
+  mFrames = new Frame[aCapacity];
+  memset(mFrames, 0, sizeof(Frame) * aCapacity);
+  mFirst = mNext = 1;
+
+  /* Different from one process and from one buffer to the next */
+#ifdef WIN32
+  unsigned int process = (unsigned int) GetCurrentProcessId();
+#else
+  unsigned int process = (unsigned int) getpid();
+#endif
+  mEpoch = ((unsigned int) time(0) * 2654435761u) ^ (process << 16) ^
+    (unsigned int) (size_t) mFrames;
+  if (mEpoch == 0)
+    mEpoch = 1;
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+  for (int i = 0; i < mCapacity; i++)
+  {
+    if (mFrames[i].mData != 0)
+      free(mFrames[i].mData);
+  }
+  delete [] mFrames;
+}
+
+/* Store a frame, dropping the oldest one if the buffer is full. Returns the
+ * frame followed by its marker, valid until the slot is reused. */
+const char *ReplayBuffer::append(const char *aFrame, int aLength, int &aTaggedLength)
+{
+  if (mNext - mFirst == (unsigned int) mCapacity)
+    mFirst++;
+
+  Frame &frame = mFrames[mNext % mCapacity];
+  char marker[32];
+  int markerLength = sprintf(marker, "* seq %u %08x\n", mNext, mEpoch);
+  if (aLength + markerLength + 1 > frame.mSize)
+  {
+    frame.mSize = ((aLength + markerLength + 1) / 1024 + 1) * 1024;
+    frame.mData = (char *) realloc(frame.mData, frame.mSize);
+  }
+  memcpy(frame.mData, aFrame, aLength);
+  memcpy(frame.mData + aLength, marker, markerLength + 1);
+  frame.mLength = aLength + markerLength;
+  mNext++;
+
+  aTaggedLength = frame.mLength;
+  return frame.mData;
+}
+
+/* Are all the frames after aSequence of aEpoch still buffered ? A client
+ * that got no frame of this buffer, the sequence 0 included, must get the
+ * initial data instead. */
+bool ReplayBuffer::contains(unsigned int aEpoch, unsigned int aSequence)
+{
+  if (aEpoch != mEpoch || aSequence == 0 || mNext == mFirst)
+    return false;
+  return (int) (aSequence + 1 - mFirst) >= 0 && (int) (mNext - 1 - aSequence) >= 0;
+}
+
+/* The frame with its marker, or 0 if it is not buffered */
+const char *ReplayBuffer::frame(unsigned int aSequence, int &aLength)
+{
+  if ((int) (aSequence - mFirst) < 0 || (int) (mNext - 1 - aSequence) < 0)
+    return 0;
+
+  Frame &frame = mFrames[aSequence % mCapacity];
+  aLength = frame.mLength;
+  return frame.mData;
+}
@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef REPLAY_BUFFER_HPP
+#define REPLAY_BUFFER_HPP
+
+/*
+ * The recent SHDR frames of a server, tagged with a sequence number, so that
+ * a client that reconnects with "* resume <seq>" gets only the frames it
+ * missed instead of a full snapshot.
+ *
+ * A frame is stored with its marker, "* seq <n> <epoch>\n", after it: once a
+ * client has received the marker, it has received the complete frame. The
+ * memory of the slots is kept from one frame to the next.
+ *
+ * The sequence numbers restart at 1 with each buffer, so the epoch, drawn
+ * when the buffer is created, tells the sequences of a previous process or
+ * buffer apart.
+ */
+class ReplayBuffer
+{
+protected:
+  struct Frame
+  {
+    char *mData;
+    int mLength;
+    int mSize;
+  };
+
+  Frame *mFrames;
+  int mCapacity;
+  unsigned int mFirst;    /* Sequence number of the oldest frame */
+  unsigned int mNext;     /* Sequence number of the next frame */
+  unsigned int mEpoch;    /* Identifies the sequence numbers of this buffer */
+
+public:
+  ReplayBuffer(int aCapacity);
+  ~ReplayBuffer();
+
+  int capacity() { return mCapacity; }
+  unsigned int last() { return mNext - 1; }
+  unsigned int epoch() { return mEpoch; }
+
+  const char *append(const char *aFrame, int aLength, int &aTaggedLength);
+  bool contains(unsigned int aEpoch, unsigned int aSequence);
+  const char *frame(unsigned int aSequence, int &aLength);
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "device_datum.hpp"
+#include "sample_bank.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_BANK_SSE2
+#include <emmintrin.h>
+#endif
+
+#pragma unmanaged // Following code explicitely not managed: native hot path
+
+SampleBank::SampleBank()
+{
+  mCount = 0;
+}
+
+/* Register a sample, returns its slot or -1 if the bank is full */
+int SampleBank::add(Sample *aSample, double aThreshold)
+{
+  if (mCount >= MAX_DEVICE_DATA)
+    return -1;
+
+  int slot = mCount;
+  mValues[slot] = 0.0;
+  mSent[slot] = 0.0;
+  mThresholds[slot] = aThreshold;
+  mStates[slot] = 0;
+  mSentStates[slot] = 0;
+  mSamples[slot] = aSample;
+  mCount++;
+  return slot;
+}
+
+/* Hand the staged value over to the sample and keep it as the detected one */
+void SampleBank::changed(int aSlot, unsigned char aState)
+{
+  double value = mValues[aSlot];
+  mSamples[aSlot]->detected(value, aState);
+  mSent[aSlot] = value;
+  mSentStates[aSlot] = aState;
+}
+
+/* Compare all the staged values to the detected ones, returns the number of
+ * samples that changed */
+int SampleBank::detect()
+{
+  int count = mCount;
+  int changes = 0;
+  int i = 0;
+
+#ifdef SAMPLE_BANK_SSE2
+  const __m128d sign = _mm_set1_pd(-0.0);
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128d delta = _mm_sub_pd(_mm_loadu_pd(mValues + i), _mm_loadu_pd(mSent + i));
+    __m128d above = _mm_cmpgt_pd(_mm_andnot_pd(sign, delta),
+                                 _mm_loadu_pd(mThresholds + i));
+    int mask = _mm_movemask_pd(above);
+
+    /* A value that differs only matters if it is available, while any
+     * change of state does */
+    unsigned char state0 = mStates[i];
+    unsigned char state1 = mStates[i + 1];
+    if (state0 != SAMPLE_HAS_VALUE)
+      mask &= ~1;
+    if (state1 != SAMPLE_HAS_VALUE)
+      mask &= ~2;
+    if (state0 != mSentStates[i])
+      mask |= 1;
+    if (state1 != mSentStates[i + 1])
+      mask |= 2;
+
+    if (mask & 1) {
+      changed(i, state0);
+      changes++;
+    }
+    if (mask & 2) {
+      changed(i + 1, state1);
+      changes++;
+    }
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    unsigned char state = mStates[i];
+    if (state != mSentStates[i] ||
+        (state == SAMPLE_HAS_VALUE && fabs(mValues[i] - mSent[i]) > mThresholds[i]))
+    {
+      changed(i, state);
+      changes++;
+    }
+  }
+
+  return changes;
+}
+
+#pragma managed // End of the unmanaged section
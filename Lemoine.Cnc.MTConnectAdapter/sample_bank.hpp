@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef SAMPLE_BANK_HPP
+#define SAMPLE_BANK_HPP
+
+class Sample;
+
+/* Sample states, as set by the producers */
+const unsigned char SAMPLE_HAS_VALUE = 1;
+const unsigned char SAMPLE_UNAVAILABLE = 2;
+
+/*
+ * The numeric samples of an adapter, stored as structure of arrays.
+ *
+ * The producers only store the new values of the bound samples in the bank,
+ * without any comparison. Before a cycle is sent, detect compares all of
+ * them to the values detected at the previous pass in a single pass over
+ * the contiguous arrays (two samples at a time with SSE2), and marks the
+ * samples that changed by more than their threshold, that is the only time
+ * the Sample objects themselves are touched.
+ */
+class SampleBank
+{
+protected:
+  double mValues[MAX_DEVICE_DATA];     /* Set by the producers */
+  double mSent[MAX_DEVICE_DATA];       /* As detected at the previous pass */
+  double mThresholds[MAX_DEVICE_DATA];
+  volatile unsigned char mStates[MAX_DEVICE_DATA]; /* Set by the producers */
+  unsigned char mSentStates[MAX_DEVICE_DATA];
+  Sample *mSamples[MAX_DEVICE_DATA];
+  int mCount;
+
+  void changed(int aSlot, unsigned char aState);
+
+public:
+  SampleBank();
+
+  int add(Sample *aSample, double aThreshold);
+  int count() { return mCount; }
+
+  /* Stage a value. Returns true if it differs from the one detected at the
+   * previous pass by more than the threshold, as detect will find it. */
+  bool set(int aSlot, double aValue) {
+    mValues[aSlot] = aValue;
+    mStates[aSlot] = SAMPLE_HAS_VALUE;
+    return mSentStates[aSlot] != SAMPLE_HAS_VALUE ||
+      fabs(aValue - mSent[aSlot]) > mThresholds[aSlot];
+  }
+  bool setUnavailable(int aSlot) {
+    unsigned char state = (unsigned char)(mStates[aSlot] | SAMPLE_UNAVAILABLE);
+    mStates[aSlot] = state;
+    return state != mSentStates[aSlot];
+  }
+  void setThreshold(int aSlot, double aThreshold) { mThresholds[aSlot] = aThreshold; }
+  double value(int aSlot) { return mValues[aSlot]; }
+  unsigned char state(int aSlot) { return mStates[aSlot]; }
+
+  int detect();
+};
+
+#endif
+
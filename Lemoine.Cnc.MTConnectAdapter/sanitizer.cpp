@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "sanitizer.hpp"
+
+#if defined(__AVX2__)
+#define SANITIZER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SANITIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef WIN32
+#include <intrin.h>
+#endif
+
+#pragma unmanaged // Following code explicitely not managed: native hot path
+
+/* Index of the lowest bit set of a non null mask */
+static inline unsigned int lowestBit(unsigned int aMask)
+{
+#ifdef WIN32
+  unsigned long index;
+  _BitScanForward(&index, aMask);
+  return (unsigned int) index;
+#else
+  return (unsigned int) __builtin_ctz(aMask);
+#endif
+}
+
+/* Write one character, escaped if needed, returns false if there is no room
+ * for it */
+static inline bool putChar(char *aTarget, size_t aCapacity, size_t &aWritten, char aChar)
+{
+  if (aChar == '|' || aChar == '\\')
+  {
+    if (aWritten + 2 > aCapacity)
+      return false;
+    aTarget[aWritten++] = '\\';
+    aTarget[aWritten++] = aChar;
+    return true;
+  }
+  if (aWritten + 1 > aCapacity)
+    return false;
+  aTarget[aWritten++] = (aChar == '\n' || aChar == '\r') ? ' ' : aChar;
+  return true;
+}
+
+size_t sanitizeText(char *aTarget, size_t aCapacity, const char *aText, size_t aLength)
+{
+  size_t written = 0;
+  size_t i = 0;
+
+  /* The blocks without any special character are copied as a whole; in the
+   * others, the characters before the first special one are, then it is
+   * escaped and the scan goes on right after it */
+#if defined(SANITIZER_AVX2)
+  const __m256i newLine = _mm256_set1_epi8('\n');
+  const __m256i carriageReturn = _mm256_set1_epi8('\r');
+  const __m256i pipe = _mm256_set1_epi8('|');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  while (i + 32 <= aLength && written + 32 <= aCapacity)
+  {
+    __m256i block = _mm256_loadu_si256((const __m256i *) (aText + i));
+    __m256i special = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, newLine), _mm256_cmpeq_epi8(block, carriageReturn)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, pipe), _mm256_cmpeq_epi8(block, backslash)));
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8(special);
+    _mm256_storeu_si256((__m256i *) (aTarget + written), block);
+    if (mask == 0)
+    {
+      i += 32;
+      written += 32;
+      continue;
+    }
+    unsigned int first = lowestBit(mask);
+    i += first;
+    written += first;
+    if (!putChar(aTarget, aCapacity, written, aText[i]))
+      break;
+    i++;
+  }
+#elif defined(SANITIZER_SSE2)
+  const __m128i newLine = _mm_set1_epi8('\n');
+  const __m128i carriageReturn = _mm_set1_epi8('\r');
+  const __m128i pipe = _mm_set1_epi8('|');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  while (i + 16 <= aLength && written + 16 <= aCapacity)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i *) (aText + i));
+    __m128i special = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(block, newLine), _mm_cmpeq_epi8(block, carriageReturn)),
+      _mm_or_si128(_mm_cmpeq_epi8(block, pipe), _mm_cmpeq_epi8(block, backslash)));
+    unsigned int mask = (unsigned int) _mm_movemask_epi8(special);
+    _mm_storeu_si128((__m128i *) (aTarget + written), block);
+    if (mask == 0)
+    {
+      i += 16;
+      written += 16;
+      continue;
+    }
+    unsigned int first = lowestBit(mask);
+    i += first;
+    written += first;
+    if (!putChar(aTarget, aCapacity, written, aText[i]))
+      break;
+    i++;
+  }
+#endif
+
+  for (; i < aLength; i++)
+  {
+    if (!putChar(aTarget, aCapacity, written, aText[i]))
+      break;
+  }
+
+  aTarget[written] = '\0';
+  return written;
+}
+
+#pragma managed // End of the unmanaged section
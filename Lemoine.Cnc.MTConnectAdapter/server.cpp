@@ -37,20 +37,41 @@
 #include "internal.hpp"
 #include "server.hpp"
 #include "client.hpp"
+#include "clock.hpp"
 #include "logger.hpp"
-
-/* Constants */
-const int READ_BUFFER_LEN = 8092;
-
-/* Create the server and bind to the port */
-Server::Server(int aPort, int aHeartbeatFreq)
+#include "binary_buffer.hpp"
+#include "filter.hpp"
+#include "replay_buffer.hpp"
+
+/* Commands the clients may send, after "* " */
+const ServerCommand Server::sCommands[] = {
+  { "PING", 4, &Server::ping },
+  { "compress", 8, &Server::compress },
+  { "binary", 6, &Server::binary },
+  { "subscribe", 9, &Server::subscribe },
+  { "rate", 4, &Server::rate },
+  { "resume", 6, &Server::resume },
+  { "stats", 5, &Server::stats },
+  { 0, 0, 0 }
+};
+
+/* Create the server and bind to the port and, if a path is given, to the
+ * local (Unix domain) socket. A port of 0 disables the TCP listener.
+ */
+Server::Server(int aPort, int aHeartbeatFreq, const char *aLocalPath)
 {
 
   mNumClients = 0;
+  mSources = 0;
+  mNumFilters = 0;
+  mReplay = 0;
+  memset(mSourceStats, 0, sizeof(mSourceStats));
+  memset(mDisconnects, 0, sizeof(mDisconnects));
   mPort = aPort;
   mTimeout = aHeartbeatFreq * 2;
-
-  SOCKADDR_IN t;
+  mSocket = INVALID_SOCKET;
+  mLocalSocket = INVALID_SOCKET;
+  mLocalPath[0] = '\0';
 
 #ifndef WIN32
   signal(SIGPIPE, SIG_IGN);
@@ -64,34 +85,68 @@ Server::Server(int aPort, int aHeartbeatFreq)
   }
 #endif
 
-  mSocket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (aPort > 0) {
+    SOCKADDR_IN t;
+    memset(&t, 0, sizeof(t));
+    t.sin_family = AF_INET;
+    t.sin_port = htons(aPort);
+    t.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    mSocket = listenOn(AF_INET, IPPROTO_TCP, (SOCKADDR *)&t, sizeof(t));
+    gLogger->info("Server started, waiting on port %d", aPort);
+  }
+
+  if (aLocalPath != 0 && aLocalPath[0] != '\0') {
+    SOCKADDR_UN u;
+    memset(&u, 0, sizeof(u));
+    u.sun_family = AF_UNIX;
+    if (strlen(aLocalPath) >= sizeof(u.sun_path)) {
+      gLogger->error("Local socket path %s is too long", aLocalPath);
+      delete this;
+      exit(1);
+    }
+    strcpy(u.sun_path, aLocalPath);
+    strcpy(mLocalPath, aLocalPath);
+
+    /* A previous instance may have left the socket file */
+    ::remove(aLocalPath);
+    mLocalSocket = listenOn(AF_UNIX, 0, (SOCKADDR *)&u, sizeof(u));
+    gLogger->info("Server started, waiting on local socket %s", aLocalPath);
+  }
+
+  // Default to a 10 second heartbeat
+  sprintf(mPong, "* PONG %d\n", aHeartbeatFreq);
+}
+
+/* Create a socket of the given family, bind it to the address and listen */
+SOCKET Server::listenOn(int aFamily, int aProtocol, SOCKADDR *aAddress, int aLength)
+{
+  SOCKET sock = ::socket(aFamily, SOCK_STREAM, aProtocol);
 
-  if (mSocket == INVALID_SOCKET) {
-    gLogger->error("Error at socket().", stderr);
+  if (sock == INVALID_SOCKET) {
+    gLogger->error("Error at socket().");
     delete this;
     exit(1);
   }
 
-  t.sin_family = AF_INET;
-  t.sin_port = htons(aPort);
-  t.sin_addr.s_addr = htonl(INADDR_ANY);
-
-  if (::bind(mSocket, (SOCKADDR *)&t, sizeof(t)) == SOCKET_ERROR) {
-    gLogger->error("Failed to bind on port %d",  aPort);
+  if (::bind(sock, aAddress, aLength) == SOCKET_ERROR) {
+    if (aFamily == AF_INET)
+      gLogger->error("Failed to bind on port %d", mPort);
+    else
+      gLogger->error("Failed to bind on local socket %s", mLocalPath);
+    ::closesocket(sock);
     delete this;
     exit(1);
   }
 
-  if (listen(mSocket, 4) == SOCKET_ERROR) {
+  if (listen(sock, 4) == SOCKET_ERROR) {
     gLogger->error("Error listening.");
+    ::closesocket(sock);
     delete this;
     exit(1);
   }
 
-  // Default to a 10 second heartbeat
-  sprintf(mPong, "* PONG %d\n", aHeartbeatFreq);
-
-  gLogger->info("Server started, waiting on port %d", aPort);
+  return sock;
 }
 
 Server::~Server()
@@ -101,8 +156,17 @@ Server::~Server()
     Client *client = mClients[i];
     delete client;
   }
-
-  ::shutdown(mSocket, SHUT_RDWR);
+  for (int i = 0; i < mNumFilters; i++)
+    delete mFilters[i];
+  if (mReplay != 0)
+    delete mReplay;
+
+  if (mSocket != INVALID_SOCKET)
+    ::shutdown(mSocket, SHUT_RDWR);
+  if (mLocalSocket != INVALID_SOCKET) {
+    ::closesocket(mLocalSocket);
+    ::remove(mLocalPath);
+  }
 
 #ifdef WINDOWS
   WSACleanup();
@@ -134,36 +198,43 @@ void Server::readFromClients()
 
   if (::select(nfds, &rset, 0, 0, &timeout) > 0)
   {
-    char buffer[READ_BUFFER_LEN];
-    int len;
-
     /* Since clients can be removed, we need to iterate backwards */
     for (int i = mNumClients - 1; i >= 0; i--)
     {
       Client *client = mClients[i];
       if (FD_ISSET(client->socket(), &rset))
-      {
-        len = client->read(buffer, READ_BUFFER_LEN);
-        if (len > 0) 
-        {
-          // Check for heartbeat
-          if (strncmp(buffer, "* PING", 6) == 0)
-          {
-            if (!client->mHeartbeats)
-              client->mHeartbeats = true;
-            client->mLastHeartbeat = getTimestamp();
-            client->write(mPong);
-          }
-          else
-            printf("Received: %s", buffer);
-        }
-        else 
-          removeClient(client);
-      }
+        receive(client);
+    }
+  }
+
+  flushClients();
+  checkHeartbeats();
+}
+
+/* Read what a client sent and process the complete command lines.
+ * The client is removed if it disconnected, but not if there was nothing to
+ * read after all.
+ */
+void Server::receive(Client *aClient)
+{
+  int received = aClient->fill();
+  if (received > 0)
+  {
+    char *line;
+    int len;
+    while ((line = aClient->nextLine(len)) != 0)
+    {
+      if (!processLine(aClient, line, len))
+        return;
+      aClient->mSettled = true;
     }
   }
+  else if (received != CLIENT_NO_INPUT)
+    removeClient(aClient, (received == 0) ? eDISCONNECT_CLOSED : eDISCONNECT_READ_ERROR);
+}
 
-  // Check heartbeats
+void Server::checkHeartbeats()
+{
   for (int i = mNumClients - 1; i >= 0; i--)
   {
     Client *client = mClients[i];
@@ -174,33 +245,392 @@ void Server::readFromClients()
       {
         gLogger->warning("Client has not sent heartbeat in over %d ms, disconnecting",
           mTimeout);
-        removeClient(client);
+        removeClient(client, eDISCONNECT_HEARTBEAT);
+      }
+    }
+  }
+}
+
+/* Dispatch a line received from a client. Only the "* <command>" lines are
+ * meaningful, the other ones are ignored.
+ * Returns false if the client was removed while the command was processed.
+ */
+bool Server::processLine(Client *aClient, char *aLine, int aLength)
+{
+  if (aLength < 3 || aLine[0] != '*' || aLine[1] != ' ')
+    return true;
+
+  char *name = aLine + 2;
+  size_t nameLength = aLength - 2;
+  for (const ServerCommand *command = sCommands; command->mName != 0; command++)
+  {
+    if (nameLength >= command->mLength &&
+        memcmp(name, command->mName, command->mLength) == 0 &&
+        (name[command->mLength] == ' ' || name[command->mLength] == '\0'))
+    {
+      char *args = name + command->mLength;
+      while (*args == ' ')
+        args++;
+      return (this->*command->mHandler)(aClient, args);
+    }
+  }
+
+  gLogger->debug("Unknown client command: %s", aLine);
+  return true;
+}
+
+/* Heartbeat: the client expects a pong with the heartbeat frequency */
+bool Server::ping(Client *aClient, char *aArgs)
+{
+  unsigned int now = getTimestamp();
+  if (!aClient->mHeartbeats)
+    aClient->mHeartbeats = true;
+  else
+    aClient->mHeartbeatInterval = deltaTimestamp(now, aClient->mLastHeartbeat);
+  aClient->mLastHeartbeat = now;
+  reply(aClient, mPong);
+  return true;
+}
+
+/* Compression: "* compress" or "* compress lz" switches the stream to the
+ * compressed frames of the Compressor, once the answer is sent uncompressed.
+ * Any other algorithm is declined with "* compress none".
+ */
+bool Server::compress(Client *aClient, char *aArgs)
+{
+  if (aArgs[0] == '\0' || strcmp(aArgs, "lz") == 0)
+  {
+    if (!aClient->compressed() && reply(aClient, "* compress lz\n") >= 0)
+      aClient->enableCompression();
+  }
+  else
+    reply(aClient, "* compress none\n");
+  return true;
+}
+
+/* Binary protocol: "* binary" switches the stream to the frames of the
+ * BinaryBuffer once the answer is sent in plain text. Each source then sends
+ * its dictionary and its current values again, in the binary format.
+ */
+bool Server::binary(Client *aClient, char *aArgs)
+{
+  if (!aClient->mBinary && aClient->write("* binary 1\n") >= 0)
+  {
+    aClient->mBinary = true;
+    aClient->mPendingSources = mSources;
+  }
+  return true;
+}
+
+/* Subscription: "* subscribe Xact Yact path_*" restricts the SHDR stream of
+ * the client to these names or prefixes, "* subscribe" or "* subscribe *"
+ * restores all the data items. The client then gets the current values of its
+ * new subscription. The binary protocol always carries all the data items.
+ */
+bool Server::subscribe(Client *aClient, char *aArgs)
+{
+  char spec[FILTER_SPEC_LEN];
+  Filter::normalize(aArgs, spec, FILTER_SPEC_LEN);
+
+  Filter *filter = 0;
+  if (spec[0] != '\0' && strcmp(spec, "*") != 0)
+  {
+    for (int i = 0; i < mNumFilters; i++)
+    {
+      if (strcmp(mFilters[i]->spec(), spec) == 0)
+      {
+        filter = mFilters[i];
+        break;
+      }
+    }
+    if (filter == 0)
+    {
+      filter = new Filter(spec);
+      mFilters[mNumFilters++] = filter;
+    }
+    filter->mRefCount++;
+  }
+
+  if (aClient->mFilter != 0)
+    releaseFilter(aClient->mFilter);
+  aClient->mFilter = filter;
+  aClient->mPendingSources = mSources;
+  return true;
+}
+
+/* Update rate: "* rate 1000" limits the SHDR stream of the client to one
+ * update per second and per source, with the latest value of the data items
+ * that changed in between. "* rate 0" restores every cycle.
+ */
+bool Server::rate(Client *aClient, char *aArgs)
+{
+  int period = atoi(aArgs);
+  aClient->mPeriod = (period > 0) ? period : 0;
+  return true;
+}
+
+/* Resume: "* resume" asks for the sequence numbers of the frames, as a
+ * "* seq <n> <epoch>" line after each of them, and "* resume <n> <epoch>",
+ * sent by a client that reconnects before it gets the initial data, asks for
+ * the frames after the frame n instead. It is answered by "* resume <n> <epoch>"
+ * and the missed frames when they are still buffered, or by "* resume none"
+ * and the initial data, in particular when the epoch is not the one of the
+ * buffer, after a restart of the adapter.
+ * Only the clients that get all the data items at every cycle may resume.
+ */
+bool Server::resume(Client *aClient, char *aArgs)
+{
+  if (aClient->mBinary || aClient->mFilter != 0 || aClient->mPeriod != 0 || mReplay == 0)
+  {
+    reply(aClient, "* resume none\n");
+    return true;
+  }
+
+  aClient->mSequenced = true;
+  if (aArgs[0] == '\0')
+    return true;
+
+  char *end;
+  unsigned int sequence = (unsigned int) strtoul(aArgs, &end, 10);
+  unsigned int epoch = (unsigned int) strtoul(end, 0, 16);
+  if (aClient->mPendingSources != mSources || !mReplay->contains(epoch, sequence))
+  {
+    reply(aClient, "* resume none\n");
+    return true;
+  }
+
+  char answer[32];
+  sprintf(answer, "* resume %u %08x\n", sequence, epoch);
+  if (!sendToClient(aClient, answer))
+    return false;
+  for (unsigned int i = sequence + 1; i != mReplay->last() + 1; i++)
+  {
+    int length;
+    const char *frame = mReplay->frame(i, length);
+    if (aClient->write(frame, length) < 0)
+    {
+      removeClient(aClient, eDISCONNECT_WRITE_ERROR);
+      return false;
+    }
+  }
+  aClient->mPendingSources = 0;
+  checkBacklog(aClient);
+  return true;
+}
+
+/* Statistics: "* stats" is answered by the latency histograms and the
+ * counters of the server and of each source, as "* stats <scope> ..." lines
+ * followed by "* stats end". The durations are in microseconds.
+ * The statistics are never cleared: the counters of the metrics endpoint
+ * must only increase.
+ */
+bool Server::stats(Client *aClient, char *aArgs)
+{
+  char answer[2048];
+  if (mStats.format(answer, sizeof(answer), "server") > 0 &&
+      reply(aClient, answer) < 0)
+    return true;
+  for (int i = 0; i < MAX_SOURCES; i++)
+  {
+    if (mSourceStats[i] == 0)
+      continue;
+    char scope[16];
+    sprintf(scope, "%d", i);
+    if (mSourceStats[i]->format(answer, sizeof(answer), scope) > 0 &&
+        reply(aClient, answer) < 0)
+      return true;
+  }
+  reply(aClient, "* stats end\n");
+  return true;
+}
+
+/* Keep the last aFrames frames for the clients that resume */
+void Server::setReplayFrames(int aFrames)
+{
+  if (aFrames <= 0 || (mReplay != 0 && mReplay->capacity() >= aFrames))
+    return;
+
+  if (mReplay != 0)
+    delete mReplay;
+  mReplay = new ReplayBuffer(aFrames);
+}
+
+/* Release a filter of a client, it is deleted once no client uses it */
+void Server::releaseFilter(Filter *aFilter)
+{
+  if (--aFilter->mRefCount > 0)
+    return;
+
+  for (int i = 0; i < mNumFilters; i++)
+  {
+    if (mFilters[i] == aFilter)
+    {
+      mFilters[i] = mFilters[--mNumFilters];
+      break;
+    }
+  }
+  delete aFilter;
+}
+
+/* Answer a command, in a command frame for a client of the binary protocol.
+ * The answer is queued even if the client lags behind. */
+int Server::reply(Client *aClient, const char *aAnswer)
+{
+  if (aClient->mBinary)
+  {
+    BinaryBuffer frame;
+    frame.beginFrame(BINARY_COMMAND);
+    frame.putBytes(aAnswer, strlen(aAnswer));
+    frame.endFrame();
+    return aClient->reply(frame.data(), (int) frame.length());
+  }
+  else
+    return aClient->reply(aAnswer, (int) strlen(aAnswer));
+}
+
+/* Send to a client. Returns false if the client was removed on an error */
+bool Server::sendToClient(Client *aClient, const char *aString)
+{
+  double start = monotonicNow();
+  int length = aClient->write(aString);
+  if (length < 0)
+  {
+    removeClient(aClient, eDISCONNECT_WRITE_ERROR);
+    return false;
+  }
+  mStats.record(Stats::eSEND, start);
+  mStats.recordWrite(length);
+  checkBacklog(aClient);
+  return true;
+}
+
+/* Send SHDR text to the clients of a filter, or to the clients without
+ * subscription if aFilter is 0. The clients of the binary protocol, the
+ * ones with an update rate, the ones that must catch up with the source and
+ * the ones that still expect its initial data are skipped.
+ * The complete frames are kept for the clients that resume.
+ */
+void Server::sendToClients(const char *aString, int aSource, Filter *aFilter)
+{
+  const char *tagged = 0;
+  int taggedLength = 0;
+  if (aFilter == 0 && mReplay != 0)
+    tagged = mReplay->append(aString, (int) strlen(aString), taggedLength);
+
+  unsigned int bit = (aSource >= 0) ? (1u << aSource) : 0;
+  for (int i = mNumClients - 1; i >= 0; i--)
+  {
+    Client *client = mClients[i];
+    if (client->mBinary || client->mPeriod != 0 || client->mFilter != aFilter ||
+        (client->mLaggingSources & bit) != 0 || (client->mPendingSources & bit) != 0)
+      continue;
+
+    if (client->mSequenced && tagged != 0)
+    {
+      double start = monotonicNow();
+      if (client->write(tagged, taggedLength) < 0)
+        removeClient(client, eDISCONNECT_WRITE_ERROR);
+      else
+      {
+        mStats.record(Stats::eSEND, start);
+        mStats.recordWrite(taggedLength);
+        checkBacklog(client);
       }
     }
+    else
+      sendToClient(client, aString);
+  }
+}
+
+bool Server::sendBinaryToClient(Client *aClient, const char *aData, int aLength)
+{
+  double start = monotonicNow();
+  if (aClient->write(aData, aLength) < 0)
+  {
+    removeClient(aClient, eDISCONNECT_WRITE_ERROR);
+    return false;
+  }
+  mStats.record(Stats::eSEND, start);
+  mStats.recordWrite(aLength);
+  checkBacklog(aClient);
+  return true;
+}
+
+/* Send a binary frame of a source to the clients of the binary protocol.
+ * The ones that still expect the initial data of the source are skipped:
+ * they get all its values at once instead.
+ */
+void Server::sendBinaryToClients(const char *aData, int aLength, int aSource)
+{
+  unsigned int bit = (aSource >= 0) ? (1u << aSource) : 0;
+  for (int i = mNumClients - 1; i >= 0; i--)
+  {
+    Client *client = mClients[i];
+    if (client->mBinary && (client->mPendingSources & bit) == 0)
+      sendBinaryToClient(client, aData, aLength);
   }
 }
 
-void Server::sendToClient(Client *aClient, const char *aString)
+/* After a client dropped its backlog, each source sends it the latest values
+ * of the items that changed since the last frame it got, or, for the binary
+ * protocol, all its values again.
+ */
+void Server::checkBacklog(Client *aClient)
 {
-  if (aClient->write(aString) < 0)
-    removeClient(aClient);
+  if (!aClient->mDropped)
+    return;
+
+  aClient->mDropped = false;
+  gLogger->warning("Client does not keep up, its backlog was dropped");
+  if (aClient->mBinary)
+    aClient->mPendingSources = mSources;
+  else
+    aClient->mLaggingSources = mSources;
 }
 
-void Server::sendToClients(const char *aString)
+/* Send the pending output of the clients, as far as their socket accepts it */
+void Server::flushClients()
 {
   for (int i = mNumClients - 1; i >= 0; i--)
-    sendToClient(mClients[i], aString);
+  {
+    Client *client = mClients[i];
+    if (client->backlogged() && client->flush() < 0)
+      removeClient(client, eDISCONNECT_WRITE_ERROR);
+  }
+}
+
+bool Server::hasBinaryClients()
+{
+  for (int i = 0; i < mNumClients; i++)
+  {
+    if (mClients[i]->mBinary)
+      return true;
+  }
+  return false;
 }
 
 Client **Server::connectToClients()
 {
   fd_set rset;
   FD_ZERO(&rset);
-  FD_SET(mSocket, &rset);
+  int nfds = 0;
+  if (mSocket != INVALID_SOCKET) {
+    FD_SET(mSocket, &rset);
+#ifndef WIN32
+    nfds = mSocket;
+#endif
+  }
+  if (mLocalSocket != INVALID_SOCKET) {
+    FD_SET(mLocalSocket, &rset);
+#ifndef WIN32
+    if (mLocalSocket > nfds)
+      nfds = mLocalSocket;
+#endif
+  }
 #ifdef WIN32
-  int nfds = 1;
+  nfds = 2;
 #else
-  int nfds = mSocket + 1;
+  nfds++;
 #endif
 
   struct timeval timeout;
@@ -211,6 +641,39 @@ Client **Server::connectToClients()
   bool added = false;
 
   if (::select(nfds, &rset, 0, 0, &timeout) > 0)
+  {
+    if (mSocket != INVALID_SOCKET && FD_ISSET(mSocket, &rset))
+      added = acceptClient(mSocket) || added;
+    if (mLocalSocket != INVALID_SOCKET && FD_ISSET(mLocalSocket, &rset))
+      added = acceptClient(mLocalSocket) || added;
+  }
+
+  if (added)
+    mClients[mNumClients] = 0;
+  else
+    clients = 0;
+
+  return clients;
+}
+
+
+/* Can the socket be put in an fd_set ? On Windows, an fd_set is a list of
+ * sockets, elsewhere a bit set that only has room for the descriptors below
+ * FD_SETSIZE. */
+bool Server::selectable(SOCKET aSocket)
+{
+#ifdef WIN32
+  return true;
+#else
+  return aSocket < FD_SETSIZE;
+#endif
+}
+
+/* Accept a client on one of the listeners. Returns true if it was added.
+ * A client whose socket can not be selected is rejected. */
+bool Server::acceptClient(SOCKET aListener)
+{
+  if (aListener == mSocket)
   {
     SOCKADDR_IN addr;
     socklen_t len = sizeof(addr);
@@ -219,29 +682,47 @@ Client **Server::connectToClients()
     SOCKET socket = ::accept(mSocket, (SOCKADDR*) &addr, &len);
     if (socket == INVALID_SOCKET) {
       gLogger->error("Error at accept().");
-      return 0;
+      return false;
+    }
+    if (!selectable(socket)) {
+      gLogger->warning("Too many open sockets, %s rejected", inet_ntoa(addr.sin_addr));
+      ::closesocket(socket);
+      return false;
     }
     gLogger->info("Connected to: %s on port %d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
 
     Client *client = new Client(socket);
-    addClient(client);
-    added = true;
+    client->configure(mSocketOptions);
+    sprintf(client->mPeer, "%s:%d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+    return addClient(client);
   }
-
-  if (added)
-    mClients[mNumClients] = 0;
   else
-    clients = 0;
+  {
+    /* The TCP options do not apply to a local socket */
+    SOCKET socket = ::accept(mLocalSocket, 0, 0);
+    if (socket == INVALID_SOCKET) {
+      gLogger->error("Error at accept() on the local socket.");
+      return false;
+    }
+    if (!selectable(socket)) {
+      gLogger->warning("Too many open sockets, local client rejected");
+      ::closesocket(socket);
+      return false;
+    }
+    gLogger->info("Connected to a local client on %s", mLocalPath);
 
-  return clients;
+    Client *client = new Client(socket);
+    client->setMaxBacklog(mSocketOptions.mMaxBacklog);
+    return addClient(client);
+  }
 }
 
-
 /* Removes a client from the client list.
 * Because the client can be removed during list iteration, lists
 * should always be iterated from last to first. 
+* The reason is counted for the metrics.
 */
-void Server::removeClient(Client *aClient)
+void Server::removeClient(Client *aClient, EDisconnectReason aReason)
 {
   int pos = 0;
 
@@ -261,24 +742,92 @@ void Server::removeClient(Client *aClient)
         mClients + (pos + 1),
         (mNumClients - pos) * sizeof(Client*));
     }
+    if (aClient->mFilter != 0)
+      releaseFilter(aClient->mFilter);
     delete aClient;
+    mDisconnects[aReason]++;
     mClients[mNumClients + 1] = 0;
   }
 }
 
-void Server::addClient(Client *aClient)
+bool Server::addClient(Client *aClient)
 {
   if (mNumClients < MAX_CLIENTS)
   {
+    aClient->mPendingSources = mSources;
+    aClient->mConnectTime = getTimestamp();
     mClients[mNumClients] = aClient;
     mNumClients++;
+    return true;
   }
   else
   {
     delete aClient;
+    mDisconnects[eDISCONNECT_REJECTED]++;
+    return false;
   }
 }
 
+/* Register a source of data. Returns its index or -1 if there are too many. */
+int Server::addSource()
+{
+  for (int i = 0; i < MAX_SOURCES; i++)
+  {
+    if ((mSources & (1u << i)) == 0)
+    {
+      mSources |= (1u << i);
+      return i;
+    }
+  }
+
+  gLogger->error("Too many adapters share the server on port %d", mPort);
+  return -1;
+}
+
+void Server::removeSource(int aSource)
+{
+  if (aSource < 0)
+    return;
+
+  unsigned int mask = ~(1u << aSource);
+  mSources &= mask;
+  mSourceStats[aSource] = 0;
+  for (int i = 0; i < mNumClients; i++)
+    mClients[i]->mPendingSources &= mask;
+}
+
+/* The statistics of a source, for the "* stats" command */
+void Server::setStats(int aSource, Stats *aStats)
+{
+  if (aSource >= 0)
+    mSourceStats[aSource] = aStats;
+}
+
+/* Return a client that still expects the initial data of the source, and
+ * consider it is sent, or 0 if there is none. A new client is left some time
+ * to ask for a resume first.
+ */
+Client *Server::nextPendingClient(int aSource)
+{
+  if (aSource < 0)
+    return 0;
+
+  unsigned int bit = 1u << aSource;
+  unsigned int now = getTimestamp();
+  for (int i = mNumClients - 1; i >= 0; i--)
+  {
+    Client *client = mClients[i];
+    if ((client->mPendingSources & bit) &&
+        (client->mSettled || deltaTimestamp(now, client->mConnectTime) >= CLIENT_SETTLE_TIME))
+    {
+      client->mPendingSources &= ~bit;
+      return client;
+    }
+  }
+
+  return 0;
+}
+
 unsigned int Server::getTimestamp()
 {
 #ifdef WIN32
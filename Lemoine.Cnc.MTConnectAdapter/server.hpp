@@ -35,43 +35,139 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
-class Client;
+#include "client.hpp"
+#include "mutex.hpp"
+#include "stats.hpp"
 
 /* Some constants */
 const int MAX_CLIENTS = 64;
+const int LOCAL_PATH_LEN = 108; /* Size of sun_path */
 
-/* A socket server abstraction */
+/* Why a client was disconnected, for the metrics */
+enum EDisconnectReason {
+  eDISCONNECT_CLOSED,      /* The client closed the connection */
+  eDISCONNECT_READ_ERROR,
+  eDISCONNECT_WRITE_ERROR,
+  eDISCONNECT_HEARTBEAT,   /* No heartbeat within twice the frequency */
+  eDISCONNECT_REJECTED,    /* Too many clients */
+  eNUM_DISCONNECT_REASONS
+};
+
+class Server;
+class Filter;
+class ReplayBuffer;
+
+/* A command a client can send on a line starting with "* ", for example "* PING".
+ * The handler gets the arguments that follow the command name, terminated by '\0'.
+ * It returns false if the client was removed, on a write error.
+ */
+typedef bool (Server::*CommandHandler)(Client *aClient, char *aArgs);
+struct ServerCommand
+{
+  const char *mName;
+  size_t mLength;
+  CommandHandler mHandler;
+};
+
+/* A socket server abstraction
+ *
+ * The I/O methods are either called by the adapter itself, or, when the
+ * server is hosted by the ServerHost, by the I/O thread of the host. In both
+ * cases the caller holds the lock of the server.
+ *
+ * Several adapters (sources) may share the same server. A new client gets
+ * the initial data of each source that is registered.
+ */
 class Server
 {
+  friend class ServerHost;
+  friend class MetricsServer;
+
 protected:
-  SOCKET mSocket;
+  SOCKET mSocket;          /* TCP listener, INVALID_SOCKET if disabled */
+  SOCKET mLocalSocket;     /* Unix domain socket listener, INVALID_SOCKET if disabled */
+  char mLocalPath[LOCAL_PATH_LEN];
   Client *mClients[MAX_CLIENTS + 1];
   int mNumClients;
   int mPort;
   char mPong[32];
   unsigned int mTimeout;
+  SocketOptions mSocketOptions;
+  unsigned int mSources;   /* One bit per registered source */
+  Filter *mFilters[MAX_CLIENTS + 1]; /* The subscriptions in use, shared by the clients */
+  int mNumFilters;
+  ReplayBuffer *mReplay;   /* The recent frames for the clients that resume, 0 if disabled */
+  Stats mStats;            /* The writes to the clients */
+  Stats *mSourceStats[MAX_SOURCES]; /* The statistics of each source, if any */
+  unsigned int mDisconnects[eNUM_DISCONNECT_REASONS];
+  Mutex mMutex;
   
 protected:
-  void removeClient(Client *aClient);
-  void addClient(Client *aClient);
-  unsigned int getTimestamp();
-  unsigned int deltaTimestamp(unsigned int, unsigned int);
+  SOCKET listenOn(int aFamily, int aProtocol, SOCKADDR *aAddress, int aLength);
+  bool acceptClient(SOCKET aListener);
+  void receive(Client *aClient);
+  void checkHeartbeats();
+  void removeClient(Client *aClient, EDisconnectReason aReason);
+  bool addClient(Client *aClient);
+
+  /* Client commands */
+  static const ServerCommand sCommands[];
+  bool processLine(Client *aClient, char *aLine, int aLength);
+  bool ping(Client *aClient, char *aArgs);
+  bool compress(Client *aClient, char *aArgs);
+  bool binary(Client *aClient, char *aArgs);
+  bool subscribe(Client *aClient, char *aArgs);
+  bool rate(Client *aClient, char *aArgs);
+  bool resume(Client *aClient, char *aArgs);
+  bool stats(Client *aClient, char *aArgs);
+  void releaseFilter(Filter *aFilter);
+  void checkBacklog(Client *aClient);
+  void flushClients();
+  int reply(Client *aClient, const char *aAnswer);
   
 public:
-  Server(int aPort, int aHeartbeatFreq);
+  Server(int aPort, int aHeartbeatFreq, const char *aLocalPath = 0);
   ~Server();
 
   // Returns the list of new clients.
   Client **connectToClients(); /* Client factory */
 
   /* I/O methods */
-  void readFromClients();         /* discard data on read side of
-                                        sockets */
-  void sendToClients(const char *aString);
-  void sendToClient(Client *aClient, const char *aString);
+  void readFromClients();         /* process the commands sent by
+                                        the clients */
+  void sendToClients(const char *aString, int aSource, Filter *aFilter = 0);
+  bool sendToClient(Client *aClient, const char *aString);
+  void sendBinaryToClients(const char *aData, int aLength, int aSource);
+  bool sendBinaryToClient(Client *aClient, const char *aData, int aLength);
+  bool hasBinaryClients();
+  static bool selectable(SOCKET aSocket);
   
+  void setSocketOptions(const SocketOptions &aOptions) { mSocketOptions = aOptions; }
+  void setReplayFrames(int aFrames);
+
+  /* Sources */
+  int addSource();
+  void removeSource(int aSource);
+  Client *nextPendingClient(int aSource);
+  void setStats(int aSource, Stats *aStats);
+
+  /* Locking */
+  void lock() { mMutex.lock(); }
+  bool tryLock() { return mMutex.tryLock(); }
+  void unlock() { mMutex.unlock(); }
+
+  /* Time in ms, for the heartbeats and the update rates */
+  unsigned int getTimestamp();
+  unsigned int deltaTimestamp(unsigned int, unsigned int);
+
   /* Getters */
   int numClients() { return mNumClients; }
+  Client *client(int aIndex) { return mClients[aIndex]; }
+  int numFilters() { return mNumFilters; }
+  Filter *filter(int aIndex) { return mFilters[aIndex]; }
+  Stats &stats() { return mStats; }
+  int port() { return mPort; }
+  const char *localPath() { return mLocalPath; }
   
 };
 
@@ -0,0 +1,238 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "server_host.hpp"
+#include "logger.hpp"
+
+ServerHost ServerHost::sInstance;
+
+ServerHost::ServerHost()
+{
+  mNumServers = 0;
+  mStarted = false;
+}
+
+/* Get the server that listens on the port or on the local socket, creating
+ * it if necessary, and start the I/O thread the first time.
+ * Returns 0 if no more server can be hosted.
+ */
+Server *ServerHost::attach(int aPort, int aHeartbeatFreq, const char *aLocalPath,
+                           const SocketOptions &aOptions)
+{
+  MutexLock lock(mMutex);
+
+  bool hasLocalPath = (aLocalPath != 0 && aLocalPath[0] != '\0');
+  for (int i = 0; i < mNumServers; i++)
+  {
+    Server *server = mServers[i];
+    if ((aPort > 0 && server->port() == aPort) ||
+        (hasLocalPath && strcmp(server->localPath(), aLocalPath) == 0))
+    {
+      mReferences[i]++;
+      return server;
+    }
+  }
+
+  if (mNumServers == MAX_HOSTED_SERVERS)
+  {
+    gLogger->error("Too many hosted servers, port %d is served by its adapter", aPort);
+    return 0;
+  }
+
+  Server *server = new Server(aPort, aHeartbeatFreq, hasLocalPath ? aLocalPath : 0);
+  server->setSocketOptions(aOptions);
+  mServers[mNumServers] = server;
+  mReferences[mNumServers] = 1;
+  mNumServers++;
+
+  if (!mStarted)
+  {
+#ifdef WIN32
+    mThread = CreateThread(0, 0, threadMain, this, 0, 0);
+    mStarted = (mThread != 0);
+#else
+    mStarted = (pthread_create(&mThread, 0, threadMain, this) == 0);
+#endif
+    if (!mStarted)
+      gLogger->error("Could not start the I/O thread of the server host");
+  }
+
+  return server;
+}
+
+/* Release a server returned by attach. The server is deleted once the last
+ * adapter that uses it detaches. The I/O thread remains for the life of the
+ * process, idle when there is no server.
+ */
+void ServerHost::detach(Server *aServer)
+{
+  MutexLock lock(mMutex);
+
+  for (int i = 0; i < mNumServers; i++)
+  {
+    if (mServers[i] == aServer)
+    {
+      if (--mReferences[i] == 0)
+      {
+        mNumServers--;
+        mServers[i] = mServers[mNumServers];
+        mReferences[i] = mReferences[mNumServers];
+        delete aServer;
+      }
+      return;
+    }
+  }
+}
+
+#ifdef WIN32
+DWORD WINAPI ServerHost::threadMain(LPVOID aHost)
+{
+  ((ServerHost *) aHost)->run();
+  return 0;
+}
+#else
+void *ServerHost::threadMain(void *aHost)
+{
+  ((ServerHost *) aHost)->run();
+  return 0;
+}
+#endif
+
+void ServerHost::run()
+{
+  for (;;)
+  {
+    fd_set rset;
+    int nfds = collect(rset);
+    if (nfds < 0)
+    {
+      usleep(HOST_SELECT_TIMEOUT * 1000);
+      continue;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = HOST_SELECT_TIMEOUT * 1000;
+    int ready = ::select(nfds + 1, &rset, 0, 0, &timeout);
+    if (ready < 0)
+    {
+      /* A socket was closed by an adapter in the meantime: build the set again */
+      usleep(1000);
+      continue;
+    }
+
+    /* Even without any activity, the heartbeats must be checked */
+    service(rset);
+  }
+}
+
+/* Fill the set with the sockets of all the servers that are not busy.
+ * The sockets that can not be selected are skipped.
+ * Returns the highest socket or -1 if there is none.
+ */
+int ServerHost::collect(fd_set &aSet)
+{
+  MutexLock lock(mMutex);
+
+  FD_ZERO(&aSet);
+  int nfds = -1;
+  int count = 0;
+  for (int i = 0; i < mNumServers; i++)
+  {
+    Server *server = mServers[i];
+    if (!server->tryLock())
+      continue;
+
+    SOCKET sockets[MAX_CLIENTS + 2];
+    int numSockets = 0;
+    if (server->mSocket != INVALID_SOCKET)
+      sockets[numSockets++] = server->mSocket;
+    if (server->mLocalSocket != INVALID_SOCKET)
+      sockets[numSockets++] = server->mLocalSocket;
+    for (int j = 0; j < server->mNumClients; j++)
+      sockets[numSockets++] = server->mClients[j]->socket();
+    server->unlock();
+
+    for (int j = 0; j < numSockets && count < FD_SETSIZE; j++)
+    {
+      if (!Server::selectable(sockets[j]))
+        continue;
+      FD_SET(sockets[j], &aSet);
+      count++;
+      if ((int) sockets[j] > nfds)
+        nfds = (int) sockets[j];
+    }
+  }
+
+  if (count == FD_SETSIZE)
+    gLogger->warning("The server host reached FD_SETSIZE sockets, some clients are not served");
+
+  return nfds;
+}
+
+/* Accept the new clients, process the commands, send the pending output and
+ * check the heartbeats of all the servers that are not busy.
+ */
+void ServerHost::service(fd_set &aSet)
+{
+  MutexLock lock(mMutex);
+
+  for (int i = 0; i < mNumServers; i++)
+  {
+    Server *server = mServers[i];
+    if (!server->tryLock())
+      continue;
+
+    /* Since clients can be removed, we need to iterate backwards */
+    for (int j = server->mNumClients - 1; j >= 0; j--)
+    {
+      Client *client = server->mClients[j];
+      if (Server::selectable(client->socket()) && FD_ISSET(client->socket(), &aSet))
+        server->receive(client);
+    }
+
+    /* Accept after reading, the new sockets were not part of the select */
+    if (server->mSocket != INVALID_SOCKET && Server::selectable(server->mSocket) &&
+        FD_ISSET(server->mSocket, &aSet))
+      server->acceptClient(server->mSocket);
+    if (server->mLocalSocket != INVALID_SOCKET && Server::selectable(server->mLocalSocket) &&
+        FD_ISSET(server->mLocalSocket, &aSet))
+      server->acceptClient(server->mLocalSocket);
+
+    server->flushClients();
+    server->checkHeartbeats();
+    server->unlock();
+  }
+}
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef SERVER_HOST_HPP
+#define SERVER_HOST_HPP
+
+#include "server.hpp"
+
+const int MAX_HOSTED_SERVERS = 256;
+const int HOST_SELECT_TIMEOUT = 100; /* ms */
+
+/*
+ * Serves the clients of all the hosted servers of the process from a single
+ * I/O thread: one select on all the listeners and client sockets, then the
+ * connections, the client commands and the heartbeats. The adapters only
+ * build and send their frames, from their own acquisition thread.
+ *
+ * A server that is locked by its adapter, because it is sending, is skipped
+ * and serviced at the next round, so that a slow machine does not stall the
+ * other ones.
+ *
+ * The adapters that use the same port share the same server. They should set
+ * a device prefix so that their data items can be told apart by the agent.
+ */
+class ServerHost
+{
+protected:
+  static ServerHost sInstance;
+
+  Mutex mMutex;            /* Protects the list of servers */
+  Server *mServers[MAX_HOSTED_SERVERS];
+  int mReferences[MAX_HOSTED_SERVERS];
+  int mNumServers;
+  bool mStarted;
+#ifdef WIN32
+  HANDLE mThread;
+  static DWORD WINAPI threadMain(LPVOID aHost);
+#else
+  pthread_t mThread;
+  static void *threadMain(void *aHost);
+#endif
+
+  ServerHost();
+  void run();
+  int collect(fd_set &aSet);
+  void service(fd_set &aSet);
+
+public:
+  static ServerHost *instance() { return &sInstance; }
+
+  Server *attach(int aPort, int aHeartbeatFreq, const char *aLocalPath,
+                 const SocketOptions &aOptions);
+  void detach(Server *aServer);
+};
+
+#endif
@@ -0,0 +1,420 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "shm_ring.hpp"
+#include "atomic.hpp"
+#include "logger.hpp"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#endif
+#endif
+
+static inline uint64_t recordSize(size_t aLength)
+{
+  return (sizeof(RecordHeader) + aLength + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+}
+
+#pragma unmanaged // Following code explicitely not managed: native hot path
+
+/*
+ * ShmRing methods
+ */
+
+/* Create the shared memory. The name follows the platform rules: for example
+ * "/pomamo-shdr-1" on Linux or "Local\pomamo-shdr-1" on Windows.
+ * If the creation fails, the ring is not open and write() does nothing.
+ */
+ShmRing::ShmRing(const char *aName, uint32_t aCapacity)
+{
+  mHeader = 0;
+  mData = 0;
+  mSnapshots = 0;
+  mDropped = 0;
+  strncpy(mName, aName, SHM_NAME_LEN);
+  mName[SHM_NAME_LEN - 1] = '\0';
+
+  uint32_t capacity = (aCapacity + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+  size_t size = sizeof(ShmRingHeader) + capacity;
+  void *address;
+
+#ifdef WIN32
+  mWakeup = 0;
+  mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD) size, mName);
+  if (mMapping == 0) {
+    gLogger->error("Could not create the shared memory %s", mName);
+    return;
+  }
+  address = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (address == 0) {
+    gLogger->error("Could not map the shared memory %s", mName);
+    CloseHandle(mMapping);
+    mMapping = 0;
+    return;
+  }
+
+  char wakeupName[SHM_NAME_LEN + 8];
+  sprintf(wakeupName, "%s.wakeup", mName);
+  mWakeup = CreateSemaphoreA(0, 0, 0x7FFFFFFF, wakeupName);
+  if (mWakeup == 0)
+    gLogger->warning("Could not create the semaphore %s, the readers will have to poll", wakeupName);
+#else
+  mMappedSize = size;
+  int fd = shm_open(mName, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    gLogger->error("Could not create the shared memory %s", mName);
+    return;
+  }
+  if (ftruncate(fd, size) != 0) {
+    gLogger->error("Could not size the shared memory %s", mName);
+    close(fd);
+    return;
+  }
+  address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    gLogger->error("Could not map the shared memory %s", mName);
+    return;
+  }
+#endif
+
+  mHeader = (ShmRingHeader *) address;
+  mData = (char *) (mHeader + 1);
+
+  /* The magic number is set last: a reader does not attach to a ring that
+   * is not initialized yet */
+  atomicStore32(&mHeader->mMagic, 0);
+  mHeader->mVersion = SHM_RING_VERSION;
+  mHeader->mCapacity = capacity;
+  mHeader->mNotify = 0;
+  mHeader->mWaiters = 0;
+  mHeader->mSnapshots = 0;
+  mHeader->mReaders = 0;
+  mHeader->mHead = 0;
+  mHeader->mReserved = 0;
+  mHeader->mSequence = 0;
+  atomicStore32(&mHeader->mMagic, SHM_RING_MAGIC);
+
+  gLogger->info("Shared memory ring %s created with %u bytes", mName, capacity);
+}
+
+ShmRing::~ShmRing()
+{
+#ifdef WIN32
+  if (mHeader != 0)
+    UnmapViewOfFile(mHeader);
+  if (mMapping != 0)
+    CloseHandle(mMapping);
+  if (mWakeup != 0)
+    CloseHandle(mWakeup);
+#else
+  if (mHeader != 0) {
+    munmap(mHeader, mMappedSize);
+    shm_unlink(mName);
+  }
+#endif
+}
+
+/* Is any consumer attached to the ring ? A consumer that crashed is
+ * still counted. */
+bool ShmRing::hasReaders()
+{
+  return mHeader != 0 && atomicLoad32(&mHeader->mReaders) > 0;
+}
+
+/* Publish a frame and wake up the waiting readers.
+ * Returns false if the frame is too large for the ring: it is dropped, and
+ * the first drop then every 100th one are logged.
+ */
+bool ShmRing::write(const char *aFrame, size_t aLength)
+{
+  if (mHeader == 0)
+    return false;
+
+  uint32_t capacity = mHeader->mCapacity;
+  uint64_t size = recordSize(aLength);
+  if (size > capacity / 2) {
+    if (mDropped++ % 100 == 0)
+      gLogger->warning("Frame of %d bytes too large for the shared memory ring %s, dropped (%u so far)",
+        (int) aLength, mName, mDropped);
+    return false;
+  }
+
+  /* Only the writer changes the head, no need for an atomic load */
+  uint64_t head = mHeader->mHead;
+  uint32_t offset = (uint32_t) (head % capacity);
+  uint64_t skip = 0;
+  if (capacity - offset < size)
+    skip = capacity - offset;
+
+  /* Announce the area that is going to be overwritten before touching it */
+  atomicStore64(&mHeader->mReserved, head + skip + size);
+  atomicFence();
+
+  if (skip > 0) {
+    RecordHeader *wrap = (RecordHeader *) (mData + offset);
+    wrap->mLength = SHM_RING_WRAP;
+    offset = 0;
+  }
+
+  uint64_t sequence = mHeader->mSequence + 1;
+  RecordHeader *record = (RecordHeader *) (mData + offset);
+  record->mLength = (uint32_t) aLength;
+  record->mPadding = 0;
+  record->mSequence = sequence;
+  memcpy(record + 1, aFrame, aLength);
+
+  atomicStore64(&mHeader->mSequence, sequence);
+  atomicStore64(&mHeader->mHead, head + skip + size);
+
+  /* The readers leave the count of the waiters themselves: a reader that
+   * is released after it stopped waiting only wakes up once for nothing */
+  atomicIncrement32(&mHeader->mNotify);
+  uint32_t waiters = atomicLoad32(&mHeader->mWaiters);
+  if (waiters > 0) {
+#ifdef WIN32
+    if (mWakeup != 0)
+      ReleaseSemaphore(mWakeup, (LONG) waiters, 0);
+#elif defined(__linux__)
+    syscall(SYS_futex, &mHeader->mNotify, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+#endif
+  }
+
+  return true;
+}
+
+/* Did a reader request all the current values since the last call ? */
+bool ShmRing::snapshotRequested()
+{
+  if (mHeader == 0)
+    return false;
+
+  uint32_t snapshots = atomicLoad32(&mHeader->mSnapshots);
+  if (snapshots == mSnapshots)
+    return false;
+
+  mSnapshots = snapshots;
+  return true;
+}
+
+/*
+ * ShmRingReader methods
+ */
+
+/* Attach to an existing ring. The first frame that is read is the next one
+ * the adapter publishes.
+ */
+ShmRingReader::ShmRingReader(const char *aName)
+{
+  mHeader = 0;
+  mData = 0;
+  mPosition = 0;
+  void *address;
+
+#ifdef WIN32
+  mWakeup = 0;
+  mMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, aName);
+  if (mMapping == 0)
+    return;
+  address = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+  if (address == 0) {
+    CloseHandle(mMapping);
+    mMapping = 0;
+    return;
+  }
+
+  char wakeupName[SHM_NAME_LEN + 8];
+  snprintf(wakeupName, sizeof(wakeupName), "%s.wakeup", aName);
+  wakeupName[sizeof(wakeupName) - 1] = '\0';
+  mWakeup = OpenSemaphoreA(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, wakeupName);
+#else
+  int fd = shm_open(aName, O_RDWR, 0);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ShmRingHeader)) {
+    close(fd);
+    return;
+  }
+  mMappedSize = st.st_size;
+  address = mmap(0, mMappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED)
+    return;
+#endif
+
+  ShmRingHeader *header = (ShmRingHeader *) address;
+  if (atomicLoad32(&header->mMagic) != SHM_RING_MAGIC || header->mVersion != SHM_RING_VERSION) {
+#ifdef WIN32
+    UnmapViewOfFile(address);
+#else
+    munmap(address, mMappedSize);
+#endif
+    return;
+  }
+
+  mHeader = header;
+  mData = (char *) (mHeader + 1);
+  mPosition = atomicLoad64(&mHeader->mHead);
+  atomicIncrement32(&mHeader->mReaders);
+}
+
+ShmRingReader::~ShmRingReader()
+{
+  if (mHeader != 0)
+    atomicDecrement32(&mHeader->mReaders);
+#ifdef WIN32
+  if (mHeader != 0)
+    UnmapViewOfFile(mHeader);
+  if (mMapping != 0)
+    CloseHandle(mMapping);
+  if (mWakeup != 0)
+    CloseHandle(mWakeup);
+#else
+  if (mHeader != 0)
+    munmap(mHeader, mMappedSize);
+#endif
+}
+
+/* Ask the adapter to publish all its current values in its next frame */
+void ShmRingReader::requestSnapshot()
+{
+  if (mHeader != 0)
+    atomicIncrement32(&mHeader->mSnapshots);
+}
+
+/* Wait for a new frame, at most aTimeout ms.
+ * Returns false if there is still no new frame.
+ */
+bool ShmRingReader::wait(int aTimeout)
+{
+  uint32_t notify = atomicLoad32(&mHeader->mNotify);
+  atomicIncrement32(&mHeader->mWaiters);
+  if (atomicLoad64(&mHeader->mHead) != mPosition) {
+    atomicDecrement32(&mHeader->mWaiters);
+    return true;
+  }
+
+#ifdef WIN32
+  if (mWakeup != 0)
+    WaitForSingleObject(mWakeup, aTimeout);
+  else
+    Sleep(1);
+#elif defined(__linux__)
+  struct timespec timeout;
+  timeout.tv_sec = aTimeout / 1000;
+  timeout.tv_nsec = (aTimeout % 1000) * 1000000L;
+  syscall(SYS_futex, &mHeader->mNotify, FUTEX_WAIT, notify, &timeout, 0, 0);
+#else
+  (void) notify;
+  usleep(1000);
+#endif
+
+  atomicDecrement32(&mHeader->mWaiters);
+  return atomicLoad64(&mHeader->mHead) != mPosition;
+}
+
+/* Read the next frame in aBuffer. The frame is not null terminated.
+ * On eFRAME, aLength and aSequence are set. aTimeout is in ms.
+ */
+ShmRingReader::EStatus ShmRingReader::read(char *aBuffer, size_t aMaxLen,
+                                           size_t &aLength, uint64_t &aSequence,
+                                           int aTimeout)
+{
+  if (mHeader == 0)
+    return eERROR;
+
+  uint32_t capacity = mHeader->mCapacity;
+  bool waited = false;
+  for (;;)
+  {
+    uint64_t head = atomicLoad64(&mHeader->mHead);
+    if (mPosition > head) {
+      /* The ring was created again */
+      mPosition = head;
+      return eOVERRUN;
+    }
+    if (mPosition == head) {
+      if (waited || aTimeout <= 0)
+        return eTIMEOUT;
+      waited = true;
+      wait(aTimeout);
+      continue;
+    }
+    if (head - mPosition > capacity) {
+      mPosition = head;
+      return eOVERRUN;
+    }
+
+    uint32_t offset = (uint32_t) (mPosition % capacity);
+    RecordHeader record;
+    memcpy(&record, mData + offset, sizeof(record));
+    atomicFence();
+    if (atomicLoad64(&mHeader->mReserved) - mPosition > capacity) {
+      mPosition = atomicLoad64(&mHeader->mHead);
+      return eOVERRUN;
+    }
+
+    if (record.mLength == SHM_RING_WRAP) {
+      mPosition += capacity - offset;
+      continue;
+    }
+
+    bool fits = (record.mLength <= aMaxLen);
+    if (fits)
+      memcpy(aBuffer, mData + offset + sizeof(record), record.mLength);
+    atomicFence();
+    if (atomicLoad64(&mHeader->mReserved) - mPosition > capacity) {
+      /* Overwritten while it was copied */
+      mPosition = atomicLoad64(&mHeader->mHead);
+      return eOVERRUN;
+    }
+
+    mPosition += recordSize(record.mLength);
+    if (!fits)
+      return eTOO_SMALL;
+
+    aLength = record.mLength;
+    aSequence = record.mSequence;
+    return eFRAME;
+  }
+}
+
+#pragma managed // End of the unmanaged section
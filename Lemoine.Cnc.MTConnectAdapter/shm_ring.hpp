@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+/*
+ * A ring buffer in shared memory to publish the SHDR frames to the consumers
+ * that run on the same host, without any socket.
+ *
+ * There is a single producer, the adapter, and any number of consumers. The
+ * producer never waits for the consumers: a consumer that is too slow is
+ * overrun and gets notified of it. Each frame is stored as a record made of
+ * a RecordHeader and the frame bytes, exactly as they are sent to the socket
+ * clients. Records are aligned on RECORD_ALIGN bytes and never wrap: when a
+ * record does not fit before the end of the data area, a wrap record fills
+ * the end and the record is written at the start.
+ *
+ * The positions are absolute byte counts since the creation of the ring, the
+ * position in the data area being the position modulo the capacity.
+ *
+ * The consumers are woken up with a futex on Linux and a named semaphore on
+ * Windows.
+ */
+
+const uint32_t SHM_RING_MAGIC = 0x52444853; /* "SHDR" */
+const uint32_t SHM_RING_VERSION = 2;
+const uint32_t SHM_RING_WRAP = 0xFFFFFFFF;   /* Length of a wrap record */
+const uint32_t RECORD_ALIGN = 16;
+const int SHM_NAME_LEN = 128;
+
+/* Start of the shared memory, followed by the data area */
+struct ShmRingHeader
+{
+  uint32_t mMagic;
+  uint32_t mVersion;
+  uint32_t mCapacity;             /* Size of the data area, multiple of RECORD_ALIGN */
+  volatile uint32_t mNotify;      /* Incremented at each new frame, futex word */
+  volatile uint32_t mWaiters;     /* Number of consumers waiting on the semaphore (Windows) */
+  volatile uint32_t mSnapshots;   /* Incremented by a consumer that needs all the current values */
+  volatile uint32_t mReaders;     /* Number of attached consumers */
+  volatile uint64_t mHead;        /* End of the last published record */
+  volatile uint64_t mReserved;    /* End of the record being written, >= mHead */
+  volatile uint64_t mSequence;    /* Sequence number of the last published frame */
+};
+
+struct RecordHeader
+{
+  uint32_t mLength;               /* Length of the frame or SHM_RING_WRAP */
+  uint32_t mPadding;
+  uint64_t mSequence;
+};
+
+/* Writer side, owned by the adapter */
+class ShmRing
+{
+protected:
+  char mName[SHM_NAME_LEN];
+  ShmRingHeader *mHeader;
+  char *mData;
+  uint32_t mSnapshots;            /* Last snapshot request counter that was served */
+  uint32_t mDropped;              /* Frames too large for the ring */
+#ifdef WIN32
+  HANDLE mMapping;
+  HANDLE mWakeup;
+#else
+  size_t mMappedSize;
+#endif
+
+public:
+  ShmRing(const char *aName, uint32_t aCapacity);
+  ~ShmRing();
+
+  bool isOpen() { return mHeader != 0; }
+  bool hasReaders();
+  bool write(const char *aFrame, size_t aLength);
+  bool snapshotRequested();
+};
+
+/* Reference reader for the local consumers */
+class ShmRingReader
+{
+public:
+  enum EStatus {
+    eFRAME,       /* A frame was read */
+    eTIMEOUT,     /* No new frame before the timeout */
+    eOVERRUN,     /* Some frames were lost, the reader restarts at the last frame */
+    eTOO_SMALL,   /* The buffer is too small for the next frame, it is skipped */
+    eERROR
+  };
+
+protected:
+  ShmRingHeader *mHeader;
+  char *mData;
+  uint64_t mPosition;             /* Position of the next record to read */
+#ifdef WIN32
+  HANDLE mMapping;
+  HANDLE mWakeup;
+#else
+  size_t mMappedSize;
+#endif
+
+  bool wait(int aTimeout);
+
+public:
+  ShmRingReader(const char *aName);
+  ~ShmRingReader();
+
+  bool isOpen() { return mHeader != 0; }
+  void requestSnapshot();
+  EStatus read(char *aBuffer, size_t aMaxLen, size_t &aLength, uint64_t &aSequence,
+               int aTimeout);
+};
+
+#endif
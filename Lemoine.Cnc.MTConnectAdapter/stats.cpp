@@ -0,0 +1,191 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "stats.hpp"
+#include "clock.hpp"
+
+#ifdef WIN32
+#include <intrin.h>
+#endif
+
+static const char *sPathNames[Stats::eNUM_PATHS] = {
+  "start", "changed", "initial", "send"
+};
+
+#pragma unmanaged // Following code explicitely not managed: native hot path
+
+/* Values below 32 have their own bucket, the larger ones are rounded down to
+ * their 5 most significant bits */
+int Histogram::bucket(unsigned int aValue)
+{
+  if (aValue < 2 * HISTOGRAM_SUB_BUCKETS)
+    return (int) aValue;
+
+#ifdef WIN32
+  unsigned long msb;
+  _BitScanReverse(&msb, aValue);
+#else
+  int msb = 31 - __builtin_clz(aValue);
+#endif
+  int shift = (int) msb - 4;
+  return 2 * HISTOGRAM_SUB_BUCKETS + (shift - 1) * HISTOGRAM_SUB_BUCKETS +
+    (int) (aValue >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+void Histogram::record(unsigned int aValue)
+{
+  mCounts[bucket(aValue)]++;
+  mCount++;
+  mSum += aValue;
+  if (aValue > mMax)
+    mMax = aValue;
+}
+
+#pragma managed // End of the unmanaged section
+
+/* The largest value of a bucket */
+unsigned int Histogram::highest(int aBucket)
+{
+  if (aBucket < 2 * HISTOGRAM_SUB_BUCKETS)
+    return (unsigned int) aBucket;
+
+  int shift = (aBucket - 2 * HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS + 1;
+  unsigned int sub = (aBucket - 2 * HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS +
+    HISTOGRAM_SUB_BUCKETS;
+  return (((sub + 1) << shift) - 1);
+}
+
+void Histogram::reset()
+{
+  memset(mCounts, 0, sizeof(mCounts));
+  mCount = 0;
+  mMax = 0;
+  mSum = 0;
+}
+
+/* The value below which aPercent % of the recorded values are, within the
+ * precision of the buckets */
+unsigned int Histogram::percentile(double aPercent)
+{
+  unsigned int total = mCount;
+  if (total == 0)
+    return 0;
+
+  double target = total * aPercent / 100.0;
+  unsigned int seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+  {
+    seen += mCounts[i];
+    if (seen > 0 && seen >= target)
+    {
+      unsigned int value = highest(i);
+      return (value < mMax) ? value : mMax;
+    }
+  }
+  return mMax;
+}
+
+void Stats::reset()
+{
+  for (int i = 0; i < eNUM_PATHS; i++)
+    mLatency[i].reset();
+  mItemsPerCycle.reset();
+  mBytesPerCycle.reset();
+  mCycles = 0;
+  mItems = 0;
+  mBytes = 0;
+}
+
+void Stats::setName(const char *aName)
+{
+  strncpy(mName, aName, STATS_NAME_LEN - 1);
+  mName[STATS_NAME_LEN - 1] = '\0';
+}
+
+void Stats::recordCycle(unsigned int aItems, unsigned int aBytes)
+{
+  mCycles++;
+  mItems += aItems;
+  mBytes += aBytes;
+  mItemsPerCycle.record(aItems);
+  mBytesPerCycle.record(aBytes);
+}
+
+static int formatHistogram(char *aTarget, int aSize, const char *aScope,
+                           const char *aName, Histogram &aHistogram)
+{
+  if (aHistogram.count() == 0 || aSize <= 0)
+    return 0;
+
+  int length = snprintf(aTarget, aSize,
+    "* stats %s %s count=%u p50=%u p90=%u p99=%u p999=%u max=%u\n",
+    aScope, aName, aHistogram.count(), aHistogram.percentile(50.0),
+    aHistogram.percentile(90.0), aHistogram.percentile(99.0),
+    aHistogram.percentile(99.9), aHistogram.max());
+  return (length < 0 || length >= aSize) ? 0 : length;
+}
+
+int Stats::format(char *aTarget, int aSize, const char *aScope)
+{
+  int length = 0;
+  for (int i = 0; i < eNUM_PATHS; i++)
+    length += formatHistogram(aTarget + length, aSize - length, aScope,
+      sPathNames[i], mLatency[i]);
+  length += formatHistogram(aTarget + length, aSize - length, aScope,
+    "items", mItemsPerCycle);
+  length += formatHistogram(aTarget + length, aSize - length, aScope,
+    "bytes", mBytesPerCycle);
+
+  if (aSize - length > 0)
+  {
+    int n = snprintf(aTarget + length, aSize - length,
+      "* stats %s total cycles=%llu items=%llu bytes=%llu\n",
+      aScope, mCycles, mItems, mBytes);
+    if (n > 0 && n < aSize - length)
+      length += n;
+  }
+  return length;
+}
+
+/* The microseconds since aStart, a time given by monotonicNow */
+unsigned int Stats::elapsed(double aStart)
+{
+  double elapsed = (monotonicNow() - aStart) * 1e6;
+  if (elapsed <= 0.0)
+    return 0;
+  if (elapsed >= 4294967295.0)
+    return 0xFFFFFFFF;
+  return (unsigned int) elapsed;
+}
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+/*
+ * A histogram of durations or sizes, in the way of the HDR histograms:
+ * the buckets are linear up to 32, then each power of two is split in 16
+ * buckets, so the values are known within about 6% whatever their
+ * magnitude. Recording a value is a bit scan and an increment.
+ */
+const int HISTOGRAM_SUB_BUCKETS = 16;
+const int HISTOGRAM_BUCKETS = 2 * HISTOGRAM_SUB_BUCKETS + 27 * HISTOGRAM_SUB_BUCKETS;
+const int STATS_NAME_LEN = 64;
+
+class Histogram
+{
+protected:
+  unsigned int mCounts[HISTOGRAM_BUCKETS];
+  unsigned int mCount;
+  unsigned int mMax;
+  unsigned long long mSum;
+
+  static int bucket(unsigned int aValue);
+  static unsigned int highest(int aBucket);
+
+public:
+  Histogram() { reset(); }
+
+  void record(unsigned int aValue);
+  void reset();
+
+  unsigned int count() { return mCount; }
+  unsigned int max() { return mMax; }
+  unsigned long long sum() { return mSum; }
+  unsigned int percentile(double aPercent);
+};
+
+/*
+ * The statistics of an adapter, or of the server for the writes to the
+ * clients. The durations are in microseconds.
+ *
+ * They are recorded by the thread that sends the values and may be read
+ * from another one without locking: a value read while it is recorded is
+ * only approximate.
+ */
+class Stats
+{
+public:
+  enum EPath {
+    eSTART,      /* Adapter::Start */
+    eCHANGED,    /* Adapter::sendChangedData */
+    eINITIAL,    /* Adapter::sendInitialData */
+    eSEND,       /* Server::sendToClient */
+    eNUM_PATHS
+  };
+
+  Histogram mLatency[eNUM_PATHS];
+  Histogram mItemsPerCycle;
+  Histogram mBytesPerCycle;
+  unsigned long long mCycles;
+  unsigned long long mItems;   /* Values sent, or writes to the clients for the server */
+  unsigned long long mBytes;
+  char mName[STATS_NAME_LEN]; /* The device of the adapter, if any */
+
+  Stats() { mName[0] = '\0'; reset(); }
+  void reset();
+  void setName(const char *aName);
+
+  void record(EPath aPath, double aStart) { mLatency[aPath].record(elapsed(aStart)); }
+  void recordCycle(unsigned int aItems, unsigned int aBytes);
+  void recordWrite(unsigned int aBytes) { mItems++; mBytes += aBytes; }
+
+  /* The statistics as "* stats <aScope> ..." lines, at most aSize bytes */
+  int format(char *aTarget, int aSize, const char *aScope);
+
+  static unsigned int elapsed(double aStart);
+};
+
+#endif
@@ -37,7 +37,7 @@
 
 StringBuffer::StringBuffer(const char *aString)
 {
-  mLength = mSize = 0;
+  mLength = mSize = mLineStart = 0;
   mTimestamp[0] = 0;
   if (aString != 0)
   {
@@ -61,7 +61,8 @@ const char *StringBuffer::append(const char* aString)
   size_t len = strlen(aString);
   size_t totalLength = mLength + len;
   size_t tsLen = strlen(mTimestamp);
-  if (mLength == 0)
+  bool lineStart = (mLength == mLineStart);
+  if (lineStart)
     totalLength += tsLen;
   if (totalLength >= mSize)
   {
@@ -74,9 +75,9 @@ const char *StringBuffer::append(const char* aString)
     mSize = newLen;
   }
   
-  if (mLength == 0 && tsLen > 0)
+  if (lineStart && tsLen > 0)
   {
-    strcpy(mBuffer, mTimestamp);
+    strcpy(mBuffer + mLength, mTimestamp);
     mLength += tsLen;
   }
 
@@ -86,12 +87,25 @@ const char *StringBuffer::append(const char* aString)
   return mBuffer;
 }
 
+/* Terminate the current line if it is not empty. The next append will start a
+ * new line, with the timestamp again.
+ */
+void StringBuffer::newLine()
+{
+  if (mLength > mLineStart)
+  {
+    append("\n");
+    mLineStart = mLength;
+  }
+}
+
 void StringBuffer::reset()
 {
   if (mBuffer != 0)
   {
     mBuffer[0] = 0;
     mLength = 0;
+    mLineStart = 0;
   }
 }
 
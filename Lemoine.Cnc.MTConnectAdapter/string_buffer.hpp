@@ -38,7 +38,7 @@
 /*
  * A simple extensible string that can be appended to. The memory will be reused
  * since it maintains its length. The string buffer also supports setting a timestamp
- * that will be prepended to the string once some data is appended.
+ * that will be prepended to each line once some data is appended to it.
  *
  * Currently allocating in 1k increments.
  */
@@ -48,6 +48,7 @@ protected:
   char *mBuffer; /* A resizable character buffer */
   size_t mSize;     /* The allocated size of the string */
   size_t mLength;   /* The length of the string */
+  size_t mLineStart; /* The position where the current line starts */
   char mTimestamp[64];
   
 public:
@@ -57,8 +58,11 @@ public:
   operator const char *() { return mBuffer; }
   const char *append(const char *aString);
   const char* operator<<(const char *aString) { return append(aString); }
+  void newLine();
   void reset();
   void timestamp();
+  void timestamp(const StringBuffer &aBuffer) { strcpy(mTimestamp, aBuffer.mTimestamp); }
+  const char *getTimestamp() { return mTimestamp; }
   size_t  length() { return mLength; }
 };
 
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "device_datum.hpp"
+#include "string_buffer.hpp"
+#include "unavailable_frame.hpp"
+
+UnavailableFrame::UnavailableFrame()
+{
+  mShared = new StringBuffer();
+  mOwn = new StringBuffer();
+  mNumOwn = 0;
+  mText = 0;
+  mLength = mSize = 0;
+  mNumLines = 0;
+  mTimestampLength = -1;
+}
+
+UnavailableFrame::~UnavailableFrame()
+{
+  delete mShared;
+  delete mOwn;
+  if (mText != 0)
+    free(mText);
+}
+
+/* The UNAVAILABLE text of a value is the one of an unavailable copy of it */
+void UnavailableFrame::add(DeviceDatum *aValue)
+{
+  DeviceDatum *copy = aValue->copy(0);
+  copy->unavailable();
+  if (copy->requiresFlush())
+  {
+    if (mNumOwn < MAX_DEVICE_DATA)
+    {
+      mOwn->append(copy->fragment());
+      mOwn->newLine();
+      mNumOwn++;
+    }
+  }
+  else
+    mShared->append(copy->fragment());
+  delete copy;
+
+  mTimestampLength = -1;
+}
+
+/* Remove all the values, to add them again once they are renamed */
+void UnavailableFrame::clear()
+{
+  mShared->reset();
+  mOwn->reset();
+  mNumOwn = 0;
+  mTimestampLength = -1;
+}
+
+/* Lay out the lines, each one after room for a timestamp */
+void UnavailableFrame::assemble(int aTimestampLength)
+{
+  int shared = (int) mShared->length();
+  int own = (int) mOwn->length();
+  int size = shared + 1 + own + (mNumOwn + 1) * aTimestampLength + 1;
+  if (size > mSize)
+  {
+    if (mText != 0)
+      free(mText);
+    mText = (char*) malloc(size);
+    mSize = size;
+  }
+
+  mLength = 0;
+  mNumLines = 0;
+  if (shared > 0)
+  {
+    mLineStarts[mNumLines++] = mLength;
+    mLength += aTimestampLength;
+    memcpy(mText + mLength, (const char *) *mShared, shared);
+    mLength += shared;
+    mText[mLength++] = '\n';
+  }
+
+  const char *line = own > 0 ? (const char *) *mOwn : "";
+  for (int i = 0; i < mNumOwn; i++)
+  {
+    const char *end = strchr(line, '\n');
+    int length = (int) (end - line) + 1;
+    mLineStarts[mNumLines++] = mLength;
+    mLength += aTimestampLength;
+    memcpy(mText + mLength, line, length);
+    mLength += length;
+    line = end + 1;
+  }
+  mText[mLength] = '\0';
+  mTimestampLength = aTimestampLength;
+}
+
+/* The frame with the timestamp of each line set to aTimestamp */
+const char *UnavailableFrame::frame(const char *aTimestamp, int &aLength)
+{
+  int timestampLength = (int) strlen(aTimestamp);
+  if (timestampLength != mTimestampLength)
+    assemble(timestampLength);
+
+  for (int i = 0; i < mNumLines; i++)
+    memcpy(mText + mLineStarts[i], aTimestamp, timestampLength);
+  aLength = mLength;
+  return mText;
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef UNAVAILABLE_FRAME_HPP
+#define UNAVAILABLE_FRAME_HPP
+
+class DeviceDatum;
+class StringBuffer;
+
+/*
+ * The frame that makes all the data values of an adapter UNAVAILABLE,
+ * maintained as the values are registered.
+ *
+ * The values that share a line are gathered on the first line, the ones
+ * that require their own line (conditions, messages) follow. The frame is
+ * assembled once with room for the timestamps at the beginning of the
+ * lines: sending it only writes the timestamp of the moment there.
+ */
+class UnavailableFrame
+{
+protected:
+  StringBuffer *mShared;  /* The values that share the first line */
+  StringBuffer *mOwn;     /* The values on their own line, one per line */
+  int mNumOwn;
+
+  char *mText;            /* The assembled frame */
+  int mLength;
+  int mSize;
+  int mLineStarts[MAX_DEVICE_DATA + 1]; /* Where the timestamps go */
+  int mNumLines;
+  int mTimestampLength;   /* Length the timestamps were assembled for, -1 if to assemble */
+
+  void assemble(int aTimestampLength);
+
+public:
+  UnavailableFrame();
+  ~UnavailableFrame();
+
+  void add(DeviceDatum *aValue);
+  void clear();
+  const char *frame(const char *aTimestamp, int &aLength);
+};
+
+#endif